@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2019 ML!PA Consulting GmbH
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     examples
+ * @{
+ *
+ * @file
+ * @brief       Expected time on air of a test packet
+ *
+ * The durations follow IEEE 802.15.4-2015 / 802.15.4g. They are meant
+ * to size timeouts, not to be exact to the microsecond.
+ *
+ * @author      Benjamin Valentin <benjamin.valentin@ml-pa.com>
+ *
+ * @}
+ */
+
+#include "net/gnrc.h"
+#include "range_test.h"
+
+/* broadcast frame: FCF, seq no, PAN ID, short dst, long src */
+#define MAC_HDR_LEN         (15)
+#define FCS_LEN_LEGACY      (2)
+#define FCS_LEN_MR          (4)
+#define PSDU_MAX_LEGACY     (127)
+#define PSDU_MAX_MR         (2047)
+
+/* compressed IPv6 + UDP header to ff02::1 */
+#define IPHC_UDP_LEN        (10)
+#define FRAG1_HDR_LEN       (4)
+#define FRAGN_HDR_LEN       (5)
+
+#define OFDM_SYMBOL_US      (120)
+#define OFDM_SHR_SYMBOLS    (6)     /* STF + LTF */
+#define OFDM_PHR_BITS       (36)
+#define OFDM_TAIL_BITS      (6)
+
+#define OQPSK_SHR_CHIPS     (576)
+#define OQPSK_PHR_BITS      (24)
+
+#define FSK_PREAMBLE_LEN    (8)
+#define FSK_SFD_LEN         (2)
+#define FSK_PHR_LEN         (2)
+
+static uint32_t _us(uint32_t bits, uint32_t bit_rate)
+{
+    return ((uint64_t)bits * US_PER_SEC + bit_rate - 1) / bit_rate;
+}
+
+static uint32_t _legacy_oqpsk(const phy_cfg_t *cfg, unsigned psdu_len)
+{
+    /* SHR and PHR are always sent at 250 kbit/s */
+    uint32_t rate = cfg->oqpsk_rate ? 1000000 : 250000;
+
+    return _us(6 * 8, 250000) + _us(8 * psdu_len, rate);
+}
+
+static uint32_t _mr_oqpsk(const phy_cfg_t *cfg, unsigned psdu_len)
+{
+    uint32_t chips = cfg->oqpsk_chips * 1000;
+    uint32_t rate_0, rate;
+
+    /* rate mode 0 uses a longer spreading code at high chip rates */
+    rate_0 = cfg->oqpsk_chips >= 1000 ? chips >> 5 : chips >> 4;
+    rate   = cfg->oqpsk_rate ? chips >> (4 - cfg->oqpsk_rate) : rate_0;
+
+    return _us(OQPSK_SHR_CHIPS, chips)
+         + _us(OQPSK_PHR_BITS, rate_0)
+         + _us(8 * psdu_len, rate);
+}
+
+static uint32_t _ofdm_rate(unsigned option, unsigned mcs)
+{
+    static const uint16_t rate_opt1[] = {
+        100, 200, 400, 800, 1200, 1600, 2400
+    };
+
+    return (rate_opt1[mcs] * 1000) >> (option - 1);
+}
+
+static uint32_t _mr_ofdm(const phy_cfg_t *cfg, unsigned psdu_len)
+{
+    /* PHR is sent with the most robust MCS of the option */
+    unsigned phr_mcs = cfg->ofdm_option < 3 ? 0 : cfg->ofdm_option - 2;
+
+    uint32_t bits_per_symbol = _ofdm_rate(cfg->ofdm_option, cfg->ofdm_mcs)
+                             * OFDM_SYMBOL_US / US_PER_SEC;
+    uint32_t symbols = (8 * psdu_len + OFDM_TAIL_BITS + bits_per_symbol - 1)
+                     / bits_per_symbol;
+
+    return OFDM_SHR_SYMBOLS * OFDM_SYMBOL_US
+         + _us(OFDM_PHR_BITS, _ofdm_rate(cfg->ofdm_option, phr_mcs))
+         + symbols * OFDM_SYMBOL_US;
+}
+
+static uint32_t _mr_fsk(const phy_cfg_t *cfg, unsigned psdu_len)
+{
+    uint32_t srate = cfg->fsk_srate * 1000;
+    uint32_t rate  = cfg->fsk_mord == 4 ? 2 * srate : srate;
+    uint32_t bits  = 8 * (FSK_PHR_LEN + psdu_len);
+
+    /* rate ½ code plus termination */
+    if (cfg->fsk_fec != IEEE802154_FEC_NONE) {
+        bits = 2 * bits + 16;
+    }
+
+    /* SHR is sent as 2-FSK */
+    return _us(8 * (FSK_PREAMBLE_LEN + FSK_SFD_LEN), srate) + _us(bits, rate);
+}
+
+uint32_t range_test_airtime_frame(const phy_cfg_t *cfg, unsigned psdu_len)
+{
+    switch (cfg->phy) {
+    case IEEE802154_PHY_OQPSK:
+        return _legacy_oqpsk(cfg, psdu_len);
+    case IEEE802154_PHY_MR_OQPSK:
+        return _mr_oqpsk(cfg, psdu_len);
+    case IEEE802154_PHY_MR_OFDM:
+        return _mr_ofdm(cfg, psdu_len);
+    case IEEE802154_PHY_MR_FSK:
+        return _mr_fsk(cfg, psdu_len);
+    }
+
+    return 0;
+}
+
+uint32_t range_test_airtime_packet(const phy_cfg_t *cfg, unsigned len, bool raw,
+                                   unsigned *frames)
+{
+    bool legacy = cfg->phy == IEEE802154_PHY_OQPSK;
+    unsigned fcs_len = legacy ? FCS_LEN_LEGACY : FCS_LEN_MR;
+    unsigned mac_payload = (legacy ? PSDU_MAX_LEGACY : PSDU_MAX_MR) - MAC_HDR_LEN - fcs_len;
+
+    if (!raw) {
+        len += IPHC_UDP_LEN;
+    }
+
+    if (raw || len <= mac_payload) {
+        *frames = 1;
+        return range_test_airtime_frame(cfg, MAC_HDR_LEN + len + fcs_len);
+    }
+
+    /* 6LoWPAN fragments carry multiples of 8 bytes */
+    unsigned frag_len = (mac_payload - FRAGN_HDR_LEN) & ~7;
+    unsigned n = (len + frag_len - 1) / frag_len;
+    unsigned last = len - (n - 1) * frag_len;
+
+    /* FRAG1 on the first frame, FRAGN on all others (RFC 4944) */
+    *frames = n;
+    return range_test_airtime_frame(cfg, MAC_HDR_LEN + FRAG1_HDR_LEN
+                                         + frag_len + fcs_len)
+         + (n - 2) * range_test_airtime_frame(cfg, MAC_HDR_LEN + FRAGN_HDR_LEN
+                                                   + frag_len + fcs_len)
+         + range_test_airtime_frame(cfg, MAC_HDR_LEN + FRAGN_HDR_LEN
+                                         + last + fcs_len);
+}
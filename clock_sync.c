@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019 ML!PA Consulting GmbH
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     examples
+ * @{
+ *
+ * @file
+ * @brief       Estimate of the responder's RTT counter
+ *
+ * Every HELLO and SWITCH exchange yields the four timestamps of an NTP
+ * exchange. The coordinator keeps offset and drift of the responder's
+ * clock and schedules the switches in the responder's time, so neither
+ * node has to touch its RTT counter.
+ *
+ * @author      Benjamin Valentin <benjamin.valentin@ml-pa.com>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+
+#include "irq.h"
+#include "periph/rtt.h"
+#include "range_test.h"
+
+/* drift is in 1/2^DRIFT_SHIFT ticks per tick */
+#define DRIFT_SHIFT     (24)
+
+/* the drift is measured over at least that many ticks,
+ * one tick of jitter is then well below 1 ppm */
+#define DRIFT_MIN_DT    ((int32_t)(60 * RTT_FREQUENCY))
+
+static struct {
+    uint32_t ref;       /* local time of the last sample */
+    int32_t offset;     /* remote - local at ref */
+    int32_t drift;
+    uint32_t drift_ref;
+    int32_t drift_offset;
+    uint16_t samples;
+} sync;
+
+void range_test_sync_reset(void)
+{
+    unsigned state = irq_disable();
+    sync.samples = 0;
+    sync.drift   = 0;
+    irq_restore(state);
+}
+
+static int32_t _predict(uint32_t local)
+{
+    int32_t dt = local - sync.ref;
+    return sync.offset + (((int64_t)sync.drift * dt) >> DRIFT_SHIFT);
+}
+
+/* t1, t4 are local, t2, t3 remote time */
+void range_test_sync_add(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4)
+{
+    /* path delay is assumed to be symmetric */
+    int32_t offset = ((int32_t)(t2 - t1) + (int32_t)(t3 - t4)) / 2;
+    uint32_t local = t1 + (t4 - t1) / 2;
+
+    unsigned state = irq_disable();
+
+    if (sync.samples == 0) {
+        sync.offset       = offset;
+        sync.ref          = local;
+        sync.drift_offset = offset;
+        sync.drift_ref    = local;
+    } else {
+        /* follow half of the phase error */
+        int32_t predicted = _predict(local);
+        sync.offset = predicted + (offset - predicted) / 2;
+        sync.ref    = local;
+
+        /* and a quarter of the frequency error */
+        int32_t dt = local - sync.drift_ref;
+        if (dt >= DRIFT_MIN_DT) {
+            int32_t drift = (int64_t)(sync.offset - sync.drift_offset) * (1 << DRIFT_SHIFT) / dt;
+            sync.drift += (drift - sync.drift) / 4;
+            sync.drift_offset = sync.offset;
+            sync.drift_ref    = local;
+        }
+    }
+
+    if (sync.samples < UINT16_MAX) {
+        ++sync.samples;
+    }
+
+    irq_restore(state);
+}
+
+uint32_t range_test_sync_to_remote(uint32_t local)
+{
+    unsigned state = irq_disable();
+    int32_t offset = sync.samples ? _predict(local) : 0;
+    irq_restore(state);
+
+    return local + offset;
+}
+
+uint32_t range_test_sync_to_local(uint32_t remote)
+{
+    unsigned state = irq_disable();
+    int32_t offset = sync.samples ? _predict(remote - sync.offset) : 0;
+    irq_restore(state);
+
+    return remote - offset;
+}
+
+void range_test_sync_print(void)
+{
+    /* ppb = drift * 10^9 / 2^24 */
+    printf("clock offset: %ld ticks, drift: %ld ppb, %u samples\n",
+           (long)(int32_t)range_test_sync_to_remote(0),
+           (long)(((int64_t)sync.drift * 1000000000) >> DRIFT_SHIFT),
+           sync.samples);
+}
@@ -0,0 +1,503 @@
+/*
+ * Copyright (C) 2019 ML!PA Consulting GmbH
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     examples
+ * @{
+ *
+ * @file
+ * @brief       Buffered writer for the result files
+ *
+ * Result records are queued in a ring buffer and written out in batches
+ * by a low priority thread, so flash latency doesn't delay the switch
+ * to the next setting.
+ *
+ * The same thread keeps a checkpoint of the sweep. It is written after
+ * the records queued before it, so it never refers to a record that is
+ * not in the log yet.
+ *
+ * @author      Benjamin Valentin <benjamin.valentin@ml-pa.com>
+ *
+ * @}
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "range_test.h"
+
+#ifdef MODULE_VFS_DEFAULT
+
+#include <fcntl.h>
+
+#include "msg.h"
+#include "thread.h"
+#include "tsrb.h"
+#include "vfs_default.h"
+
+#ifndef DATA_DIR
+#define DATA_DIR VFS_DEFAULT_DATA "/range"
+#endif
+
+/* size of the queue, records that don't fit are dropped */
+#ifndef STORE_BUF_SIZE
+#define STORE_BUF_SIZE      (4096)
+#endif
+
+/* bytes written with one vfs_write(), ideally a flash page */
+#ifndef STORE_BATCH_SIZE
+#define STORE_BATCH_SIZE    (512)
+#endif
+
+/* write a partial batch if no new data arrived for that long, 0 to wait for close */
+#ifndef STORE_FLUSH_MS
+#define STORE_FLUSH_MS      (5000)
+#endif
+
+/* fsync after that many batches, 0 to only sync on close */
+#ifndef STORE_SYNC_BATCHES
+#define STORE_SYNC_BATCHES  (0)
+#endif
+
+#define STORE_MSG_DATA          (0x0100)
+#define STORE_MSG_OPEN          (0x0101)
+#define STORE_MSG_CLOSE         (0x0102)
+#define STORE_MSG_CHECKPOINT    (0x0103)
+#define STORE_MSG_RESUME        (0x0104)
+#define STORE_MSG_CLEAR         (0x0105)
+#define STORE_MSG_FLUSH         (0x0106)
+
+#define CHECKPOINT_FILE     DATA_DIR "/checkpoint"
+#define CHECKPOINT_MAGIC    (0x50434752)    /* "RGCP" */
+#define CHECKPOINT_MAX      (64)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t log_size;      /* bytes of the log covered by the checkpoint */
+    uint16_t log_num;
+    uint16_t len;           /* of the caller's data that follows */
+} checkpoint_hdr_t;
+
+static char _stack[THREAD_STACKSIZE_MAIN];
+static msg_t _queue[4];
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+
+static tsrb_t _rb;
+static uint8_t _rb_buf[STORE_BUF_SIZE];
+static uint8_t _batch[STORE_BATCH_SIZE];
+
+static int _fd;
+static unsigned _unsynced;
+static unsigned _num;
+static uint32_t _offset;
+
+/* only the caller writes it while no checkpoint is pending */
+static uint8_t _cp_buf[CHECKPOINT_MAX];
+static uint16_t _cp_len;
+static volatile bool _cp_pending;
+
+static struct {
+    uint32_t bytes;
+    uint32_t writes;
+    uint32_t latency_sum;
+    uint32_t latency_max;
+    uint32_t failed;
+    uint32_t dropped;
+} stats;
+
+static void _write_batch(size_t len)
+{
+    len = tsrb_get(&_rb, _batch, len);
+
+    uint32_t start = xtimer_now();
+    ssize_t res = vfs_write(_fd, _batch, len);
+    uint32_t latency = xtimer_now() - start;
+
+    if (res < 0) {
+        printf("write failed: %d\n", (int)res);
+        stats.failed += len;
+        return;
+    }
+
+    _offset += res;
+    stats.bytes += res;
+    stats.writes++;
+    stats.latency_sum += latency;
+    stats.latency_max  = MAX(stats.latency_max, latency);
+
+#if STORE_SYNC_BATCHES
+    if (++_unsynced >= STORE_SYNC_BATCHES) {
+        vfs_fsync(_fd);
+        _unsynced = 0;
+    }
+#endif
+}
+
+static void _flush(bool all)
+{
+    while (tsrb_avail(&_rb) >= STORE_BATCH_SIZE) {
+        _write_batch(STORE_BATCH_SIZE);
+    }
+
+    if (all && tsrb_avail(&_rb) > 0) {
+        _write_batch(tsrb_avail(&_rb));
+    }
+}
+
+static void _open(unsigned num, uint32_t offset)
+{
+    char buffer[48];
+
+    vfs_mkdir(DATA_DIR, 0777);
+    snprintf(buffer, sizeof(buffer), DATA_DIR "/%u.bin", num);
+
+    /* only a resumed log keeps its records, a new one replaces an old log */
+    _fd = vfs_open(buffer, offset ? O_WRONLY : O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (_fd < 0) {
+        printf("can't create file: %d\n", _fd);
+        _fd = 0;
+        return;
+    }
+
+    /* records after the checkpoint are written again */
+    if (offset && vfs_lseek(_fd, offset, SEEK_SET) < 0) {
+        printf("can't seek to %lu\n", (unsigned long)offset);
+    }
+
+    _num = num;
+    _offset = offset;
+}
+
+static int _read_checkpoint(checkpoint_hdr_t *hdr, void *data, size_t len)
+{
+    int fd = vfs_open(CHECKPOINT_FILE, O_RDONLY, 0);
+
+    if (fd < 0) {
+        return fd;
+    }
+
+    int res = -EINVAL;
+    if (vfs_read(fd, hdr, sizeof(*hdr)) == sizeof(*hdr) &&
+        hdr->magic == CHECKPOINT_MAGIC && hdr->len == len &&
+        (len == 0 || vfs_read(fd, data, len) == (ssize_t)len)) {
+        res = 0;
+    }
+
+    vfs_close(fd);
+    return res;
+}
+
+/* everything queued so far goes to flash first */
+static void _write_checkpoint(void)
+{
+    checkpoint_hdr_t hdr = {
+        .magic = CHECKPOINT_MAGIC,
+        .len = _cp_len,
+    };
+
+    if (_fd > 0) {
+        _flush(true);
+        vfs_fsync(_fd);
+    }
+
+    hdr.log_num  = _num;
+    hdr.log_size = _offset;
+
+    /* replace the old checkpoint only once the new one is complete */
+    int fd = vfs_open(CHECKPOINT_FILE ".tmp", O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+        printf("can't write checkpoint: %d\n", fd);
+        return;
+    }
+
+    vfs_write(fd, &hdr, sizeof(hdr));
+    vfs_write(fd, _cp_buf, _cp_len);
+    vfs_fsync(fd);
+    vfs_close(fd);
+
+    vfs_unlink(CHECKPOINT_FILE);
+    vfs_rename(CHECKPOINT_FILE ".tmp", CHECKPOINT_FILE);
+}
+
+/* continue the log of the checkpoint */
+static int _resume(void)
+{
+    checkpoint_hdr_t hdr;
+
+    /* the caller's data was already checked, only the log is of interest */
+    int fd = vfs_open(CHECKPOINT_FILE, O_RDONLY, 0);
+    if (fd < 0) {
+        return fd;
+    }
+
+    int res = vfs_read(fd, &hdr, sizeof(hdr));
+    vfs_close(fd);
+
+    if (res != sizeof(hdr) || hdr.magic != CHECKPOINT_MAGIC) {
+        return -EINVAL;
+    }
+
+    _open(hdr.log_num, hdr.log_size);
+    return _fd > 0 ? 0 : -EIO;
+}
+
+static void _close(void)
+{
+    if (_fd <= 0) {
+        return;
+    }
+
+    _flush(true);
+    vfs_fsync(_fd);
+    vfs_close(_fd);
+    _fd = 0;
+    _unsynced = 0;
+}
+
+static void *_writer(void *arg)
+{
+    msg_init_queue(_queue, ARRAY_SIZE(_queue));
+
+    while (1) {
+        msg_t m;
+
+        if (STORE_FLUSH_MS && tsrb_avail(&_rb) > 0) {
+            if (xtimer_msg_receive_timeout(&m, STORE_FLUSH_MS * US_PER_MS) < 0) {
+                _flush(true);
+                continue;
+            }
+        } else {
+            msg_receive(&m);
+        }
+
+        switch (m.type) {
+        case STORE_MSG_DATA:
+            _flush(false);
+            break;
+        case STORE_MSG_OPEN:
+            _close();
+            _open(m.content.value, 0);
+            msg_reply(&m, &m);
+            break;
+        case STORE_MSG_CLOSE:
+            _close();
+            msg_reply(&m, &m);
+            break;
+        case STORE_MSG_CHECKPOINT:
+            _write_checkpoint();
+            _cp_pending = false;
+            break;
+        case STORE_MSG_RESUME:
+            _close();
+            m.content.value = _resume();
+            msg_reply(&m, &m);
+            break;
+        case STORE_MSG_CLEAR:
+            vfs_unlink(CHECKPOINT_FILE);
+            msg_reply(&m, &m);
+            break;
+        case STORE_MSG_FLUSH:
+            _flush(true);
+            msg_reply(&m, &m);
+            break;
+        }
+    }
+
+    return arg;
+}
+
+static void _start_writer(void)
+{
+    if (_pid == KERNEL_PID_UNDEF) {
+        tsrb_init(&_rb, _rb_buf, sizeof(_rb_buf));
+        _pid = thread_create(_stack, sizeof(_stack), THREAD_PRIORITY_IDLE - 1,
+                             THREAD_CREATE_STACKTEST, _writer, NULL, "writer");
+    }
+}
+
+/* the number after the highest log on the file system, so that a
+ * reboot doesn't overwrite the logs of earlier sweeps */
+unsigned range_test_store_next(void)
+{
+    unsigned next = 0;
+    vfs_DIR dir;
+    vfs_dirent_t entry;
+
+    if (vfs_opendir(&dir, DATA_DIR) < 0) {
+        return 0;
+    }
+
+    while (vfs_readdir(&dir, &entry) > 0) {
+        char *end;
+        unsigned long num = strtoul(entry.d_name, &end, 10);
+
+        if (end != entry.d_name && strcmp(end, ".bin") == 0 && num >= next) {
+            next = num + 1;
+        }
+    }
+
+    vfs_closedir(&dir);
+    return next;
+}
+
+void range_test_store_open(unsigned num)
+{
+    msg_t m = {
+        .type = STORE_MSG_OPEN,
+        .content.value = num,
+    };
+
+    _start_writer();
+
+    memset(&stats, 0, sizeof(stats));
+    msg_send_receive(&m, &m, _pid);
+}
+
+int range_test_store_resume(void)
+{
+    msg_t m = {
+        .type = STORE_MSG_RESUME,
+    };
+
+    _start_writer();
+
+    memset(&stats, 0, sizeof(stats));
+    msg_send_receive(&m, &m, _pid);
+
+    return (int)m.content.value;
+}
+
+void range_test_store_checkpoint(const void *data, size_t len)
+{
+    /* the previous one is still being written, the next one will do */
+    if (_pid == KERNEL_PID_UNDEF || _cp_pending || len > sizeof(_cp_buf)) {
+        return;
+    }
+
+    memcpy(_cp_buf, data, len);
+    _cp_len = len;
+    _cp_pending = true;
+
+    msg_t m = {
+        .type = STORE_MSG_CHECKPOINT
+    };
+    if (msg_try_send(&m, _pid) != 1) {
+        _cp_pending = false;
+    }
+}
+
+int range_test_store_checkpoint_load(void *data, size_t len)
+{
+    checkpoint_hdr_t hdr;
+
+    return _read_checkpoint(&hdr, data, len);
+}
+
+void range_test_store_checkpoint_clear(void)
+{
+    msg_t m = {
+        .type = STORE_MSG_CLEAR
+    };
+
+    _start_writer();
+    msg_send_receive(&m, &m, _pid);
+}
+
+void range_test_store_write(const void *data, size_t len)
+{
+    /* only the caller adds to the buffer, so the free space can only grow */
+    if (_fd <= 0 || (size_t)tsrb_free(&_rb) < len) {
+        stats.dropped += len;
+        return;
+    }
+
+    tsrb_add(&_rb, data, len);
+
+    /* the writer only picks up full batches, this (re)starts its flush timer */
+    msg_t m = {
+        .type = STORE_MSG_DATA
+    };
+    msg_try_send(&m, _pid);
+}
+
+/* waits for the writer instead of dropping data, for the log header */
+int range_test_store_write_all(const void *data, size_t len)
+{
+    const uint8_t *pos = data;
+    uint32_t failed = stats.failed;
+
+    while (len) {
+        if (_fd <= 0 || stats.failed != failed) {
+            return -EIO;
+        }
+
+        size_t chunk = MIN(len, (size_t)tsrb_free(&_rb));
+        if (chunk == 0) {
+            msg_t m = {
+                .type = STORE_MSG_FLUSH
+            };
+            msg_send_receive(&m, &m, _pid);
+            continue;
+        }
+
+        tsrb_add(&_rb, pos, chunk);
+        pos += chunk;
+        len -= chunk;
+    }
+
+    msg_t m = {
+        .type = STORE_MSG_DATA
+    };
+    msg_try_send(&m, _pid);
+
+    return 0;
+}
+
+void range_test_store_close(void)
+{
+    msg_t m = {
+        .type = STORE_MSG_CLOSE
+    };
+
+    if (_pid == KERNEL_PID_UNDEF) {
+        return;
+    }
+
+    msg_send_receive(&m, &m, _pid);
+
+    printf("stored %lu bytes in %lu writes, latency avg %lu µs, max %lu µs",
+           (unsigned long)stats.bytes, (unsigned long)stats.writes,
+           (unsigned long)(stats.writes ? stats.latency_sum / stats.writes : 0),
+           (unsigned long)stats.latency_max);
+    if (stats.dropped || stats.failed) {
+        printf(", %lu bytes dropped", (unsigned long)(stats.dropped + stats.failed));
+    }
+    puts("");
+}
+
+#else /* MODULE_VFS_DEFAULT */
+
+/* without a file system there is nothing to resume from */
+void range_test_store_checkpoint(const void *data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+int range_test_store_checkpoint_load(void *data, size_t len)
+{
+    (void)data;
+    (void)len;
+    return -ENOTSUP;
+}
+
+void range_test_store_checkpoint_clear(void) {}
+
+#endif /* MODULE_VFS_DEFAULT */
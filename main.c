@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "irq.h"
 #include "thread.h"
 #include "mutex.h"
 #include "periph/rtt.h"
@@ -41,19 +42,55 @@
 #define TEST_PORT   (2323)
 #define QUEUE_SIZE  (4)
 
-#define MAX(a, b) ((a) < (b) ? (b) : (a))
+/* raw frames start with the message type, which is in the 6LoWPAN NALP
+ * (not a LoWPAN frame) dispatch range, so 6LoWPAN will ignore them */
+#define TEST_RAW_TYPE_MAX   (0x3f)
+
+#ifdef MODULE_GNRC_SIXLOWPAN
+#define GNRC_NETTYPE_RAW    GNRC_NETTYPE_SIXLOWPAN
+#else
+#define GNRC_NETTYPE_RAW    GNRC_NETTYPE_UNDEF
+#endif
+
+/* max. number of pings that can be in flight per interface */
+#ifndef PING_WINDOW_MAX
+#define PING_WINDOW_MAX     (8)
+#endif
 
 enum {
     TEST_HELLO,
     TEST_HELLO_ACK,
     TEST_PING,
-    TEST_PONG
+    TEST_PONG,
+    TEST_SWITCH,
+    TEST_SWITCH_ACK,
+    TEST_RESYNC,
+    TEST_DATA,
+    TEST_SUMMARY_REQ,
+    TEST_SUMMARY,
 };
 
+enum {
+    TEST_FLAG_ADAPTIVE_DWELL = 0x1,
+    TEST_FLAG_RAW            = 0x2,
+    TEST_FLAG_STREAM         = 0x4,
+};
+
+/* RTT counter values of a two-way exchange, t1 is stamped by the
+ * coordinator, t2 (reception) and t3 (reply) by the responder */
+typedef struct {
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t t3;
+} test_sync_t;
+
 typedef struct {
     uint8_t type;
-    uint32_t now;
+    uint8_t flags;
+    uint16_t step;          /* where the sweep starts */
     uint32_t period;
+    test_sync_t sync;
+    range_plan_t plan;
 } test_hello_t;
 
 typedef struct {
@@ -62,10 +99,53 @@ typedef struct {
     uint8_t lqi;
     uint8_t _padding;
     uint32_t ticks;
+    uint32_t rx_time;       /* responder's RTT counter when the ping arrived */
     uint16_t seq_no;
+    uint16_t step;          /* sender's range_test_step() */
+    uint16_t rx_count;      /* distinct pings the responder got on the step */
+    uint16_t turnaround;    /* µs from ping reception to pong submission */
+    uint16_t rx_dups;       /* pings the responder got more than once */
+    uint16_t rx_reordered;  /* pings that arrived after a later one */
     uint8_t payload[];
 } test_pingpong_t;
 
+/* both sides switch to step at the responder's RTT counter value at,
+ * a TEST_RESYNC switches right away */
+typedef struct {
+    uint8_t type;
+    uint8_t _padding;
+    uint16_t step;
+    uint32_t at;
+    test_sync_t sync;
+} test_switch_t;
+
+/* what the responder received of the frames streamed on a setting,
+ * the first frame of a radio only starts the clock */
+typedef struct {
+    uint8_t type;
+    uint8_t _padding;
+    uint16_t step;
+    struct {
+        uint32_t pkts;
+        uint32_t bytes;         /* after the first frame */
+        uint32_t span_us;       /* from the first to the last frame */
+    } radio[GNRC_NETIF_NUMOF];
+} test_summary_t;
+
+/* frames handed to a radio that have not been sent yet while streaming */
+#define STREAM_QUEUE        (2)
+
+/* announcements of a switch before giving up */
+#define SWITCH_RETRIES      (3)
+
+/* the responder switches on its own that long after the last
+ * announcement could have been answered, covers the clock error */
+#define SWITCH_GUARD_US     (20 * US_PER_MS)
+
+/* after that many steps without contact both sides meet on setting 0 */
+#define RESYNC_STEPS        (8)
+#define RESYNC_RETRIES      (10)
+
 static char test_server_stack[THREAD_STACKSIZE_MAIN];
 static char test_coordinator_stack[THREAD_STACKSIZE_MAIN];
 static char test_sender_stack[GNRC_NETIF_NUMOF][THREAD_STACKSIZE_SMALL];
@@ -73,13 +153,72 @@ static char test_sender_stack[GNRC_NETIF_NUMOF][THREAD_STACKSIZE_SMALL];
 static mutex_t _test_start = MUTEX_INIT_LOCKED;
 static sema_inv_t _batch_done;
 static volatile uint32_t last_alarm;
+
+/* responder: position is taken from the coordinator */
+static struct {
+    bool active;
+    bool heard;         /* coordinator was heard on the current step */
+    uint8_t silent;     /* steps without hearing the coordinator */
+} follow;
 static uint32_t test_period = TEST_PERIOD;
+static uint8_t ping_window = 1;
+static bool raw_mode;
+static bool adaptive_dwell;
+/* send back-to-back instead of ping-pong */
+static bool stream_mode;
+
+/* coordinator state that is saved at every setting boundary */
+typedef struct {
+    range_plan_t plan;
+    uint32_t period;
+    uint16_t step;          /* first step that is not in the log */
+    uint8_t flags;
+    uint8_t window;
+    uint8_t early_margin;
+} test_checkpoint_t;
+
+/* step the next test starts at */
+static uint16_t resume_step;
+
+/* end a setting once its PDR is known to ±early_margin %, 0 to disable */
+static uint8_t early_margin;
+static mutex_t _setting_done = MUTEX_INIT_LOCKED;
+static bool early_armed;
 
 uint32_t range_test_period_ms(void)
 {
     return (test_period * 1000) / RTT_FREQUENCY;
 }
 
+bool range_test_raw_mode(void)
+{
+    return raw_mode;
+}
+
+/* time on the setting that is 'ahead' steps from the current one */
+static uint32_t _dwell_ticks(unsigned ahead)
+{
+    return (range_test_dwell_ms(ahead) * RTT_FREQUENCY) / 1000;
+}
+
+static uint32_t _us_to_ticks(uint32_t us)
+{
+    return ((uint64_t)us * RTT_FREQUENCY) / US_PER_SEC;
+}
+
+static int32_t _ticks_to_us(int32_t ticks)
+{
+    return ((int64_t)ticks * US_PER_SEC) / RTT_FREQUENCY;
+}
+
+/* latest time at which the current setting ends */
+static uint32_t _fallback_ticks(void)
+{
+    uint32_t announce = SWITCH_RETRIES * range_test_control_timeout(sizeof(test_switch_t));
+
+    return _dwell_ticks(0) + _us_to_ticks(announce + SWITCH_GUARD_US);
+}
+
 unsigned range_test_radio_pid(void)
 {
     static kernel_pid_t radio_pid;
@@ -107,11 +246,85 @@ unsigned range_test_radio_numof(void)
     return radio_numof;
 }
 
-static void _rtt_alarm(void* ctx)
+/* end of the reception of the frame just dequeued, as seen by the radio */
+static bool _rx_done(kernel_pid_t netif, uint32_t now_us, uint32_t *at)
+{
+    /* only the tested radios are tracked */
+    if ((unsigned)(netif - range_test_radio_pid()) >= range_test_radio_numof()) {
+        return false;
+    }
+
+    uint32_t rx_done = range_test_radio_rx_done(netif);
+
+    /* a later frame moves the stamp, it's only ours if nothing is queued behind */
+    if (msg_avail() > 0 || now_us - rx_done >= range_test_get_timeout(netif)) {
+        return false;
+    }
+
+    *at = rx_done;
+    return true;
+}
+
+/* split the RTT of a pong into time on the radio, the responder's turnaround
+ * and the time in the local stack */
+static void _radio_time(kernel_pid_t netif, const test_pingpong_t *pp,
+                        uint32_t tx_start, uint32_t now_us)
+{
+    uint32_t rx_done;
+
+    if (tx_start == 0 || !_rx_done(netif, now_us, &rx_done)) {
+        return;
+    }
+
+    uint32_t rtt  = now_us - pp->ticks;
+    uint32_t span = rx_done - tx_start;
+    if (tx_start - pp->ticks > rtt || span > rtt) {
+        return;
+    }
+
+    /* the responder measured its part from its own radio's RX end */
+    uint32_t radio = xtimer_usec_from_ticks(span);
+    radio -= MIN(pp->turnaround, radio);
+
+    range_test_add_radio_time(netif, radio, xtimer_usec_from_ticks(rtt - span));
+}
+
+/* split the RTT of a pong with the responder's timestamps */
+static void _oneway(kernel_pid_t netif, const test_pingpong_t *pp,
+                    uint32_t now, uint32_t now_us)
 {
-    last_alarm += test_period;
-    rtt_set_alarm(last_alarm, _rtt_alarm, ctx);
+    int32_t rtt = xtimer_usec_from_ticks(now_us - pp->ticks);
+    int32_t turnaround = MIN(pp->turnaround, rtt);
+
+    /* local RTT counter at the time the ping was sent */
+    uint32_t sent = now - _us_to_ticks(rtt);
+    int32_t up = _ticks_to_us(range_test_sync_to_local(pp->rx_time) - sent);
 
+    /* the clock estimate is good to a few ticks, keep it plausible */
+    up = MAX(0, MIN(up, rtt - turnaround));
+
+    range_test_add_oneway(netif, up, turnaround, rtt - turnaround - up);
+}
+
+/* called on every pong and loss, ends the setting once the PDR converged */
+static void _early_check(void)
+{
+    if (!early_margin || !early_armed || !range_test_pdr_converged(early_margin)) {
+        return;
+    }
+
+    unsigned state = irq_disable();
+    bool fire = early_armed;
+    early_armed = false;
+    irq_restore(state);
+
+    if (fire) {
+        mutex_unlock(&_setting_done);
+    }
+}
+
+static void _rtt_alarm(void* ctx)
+{
     mutex_unlock(ctx);
 }
 
@@ -162,6 +375,56 @@ error:
     return false;
 }
 
+static bool _l2_send(int netif, const void* data, size_t len)
+{
+    gnrc_pktsnip_t *pkt_out, *netif_hdr;
+
+    /* no interface given, send on all radios */
+    if (netif == 0) {
+        bool res = false;
+        for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+            res |= _l2_send(range_test_radio_pid() + i, data, len);
+        }
+        return res;
+    }
+
+    if (!(pkt_out = gnrc_pktbuf_add(NULL, data, len, GNRC_NETTYPE_UNDEF))) {
+        return false;
+    }
+    if (!(netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0))) {
+        goto error;
+    }
+
+    ((gnrc_netif_hdr_t *)netif_hdr->data)->flags |= GNRC_NETIF_HDR_FLAGS_BROADCAST;
+    LL_PREPEND(pkt_out, netif_hdr);
+
+    if (gnrc_netapi_send(netif, pkt_out) < 1) {
+        goto error;
+    }
+
+    return true;
+error:
+    gnrc_pktbuf_release(pkt_out);
+    return false;
+}
+
+static bool _send(int netif, const ipv6_addr_t* addr, uint16_t port, const void* data, size_t len)
+{
+    if (raw_mode) {
+        return _l2_send(netif, data, len);
+    }
+
+    return _udp_send(netif, addr, port, data, len);
+}
+
+static bool _l2_reply(gnrc_pktsnip_t *pkt_in, void* data, size_t len)
+{
+    gnrc_pktsnip_t *snip_if = gnrc_pktsnip_search_type(pkt_in, GNRC_NETTYPE_NETIF);
+    gnrc_netif_hdr_t *netif = snip_if->data;
+
+    return _l2_send(netif->if_pid, data, len);
+}
+
 static bool _udp_reply(gnrc_pktsnip_t *pkt_in, void* data, size_t len)
 {
     gnrc_pktsnip_t *snip_udp = pkt_in->next;
@@ -175,15 +438,123 @@ static bool _udp_reply(gnrc_pktsnip_t *pkt_in, void* data, size_t len)
     return _udp_send(netif->if_pid, &ip->src, byteorder_ntohs(udp->src_port), data, len);
 }
 
-static bool _send_ping(int netif, const ipv6_addr_t* addr, uint16_t port, uint16_t size)
+/* send the received packet back with its (modified) payload, this saves
+ * allocating and copying the payload for every pong.
+ * Returns false if pkt was left untouched, it is consumed otherwise. */
+static bool _reply_in_place(gnrc_pktsnip_t *pkt)
+{
+    gnrc_pktsnip_t *snip_udp = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_UDP);
+    gnrc_pktsnip_t *snip_ip  = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_IPV6);
+    gnrc_pktsnip_t *snip_if  = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_NETIF);
+    gnrc_pktsnip_t *netif_hdr;
+
+    if (snip_if == NULL || (snip_udp && snip_ip == NULL)) {
+        return false;
+    }
+
+    /* the headers are rewritten, nobody else may see them */
+    for (gnrc_pktsnip_t *snip = pkt; snip; snip = snip->next) {
+        if (snip->users > 1) {
+            return false;
+        }
+    }
+
+    /* L2 addresses and link quality of the ping don't apply to the pong */
+    kernel_pid_t netif = ((gnrc_netif_hdr_t *)snip_if->data)->if_pid;
+    if (!(netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0))) {
+        return false;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, gnrc_netif_get_by_pid(netif));
+    pkt = gnrc_pktbuf_remove_snip(pkt, snip_if);
+
+    if (snip_udp == NULL) {
+        ((gnrc_netif_hdr_t *)netif_hdr->data)->flags |= GNRC_NETIF_HDR_FLAGS_BROADCAST;
+        LL_PREPEND(pkt, netif_hdr);
+
+        if (gnrc_netapi_send(netif, pkt) < 1) {
+            gnrc_pktbuf_release(pkt);
+        }
+        return true;
+    }
+
+    udp_hdr_t *udp = snip_udp->data;
+    network_uint16_t port = udp->src_port;
+    udp->src_port = udp->dst_port;
+    udp->dst_port = port;
+    udp->checksum.u16 = 0;
+
+    /* the ping may have gone to a multicast address, let IPv6 pick the source */
+    ipv6_hdr_t *ip = snip_ip->data;
+    ip->dst = ip->src;
+    ipv6_addr_set_unspecified(&ip->src);
+    ip->hl  = 0;
+
+    /* received packets are ordered payload first */
+    if (!(pkt = gnrc_pktbuf_reverse_snips(pkt))) {
+        gnrc_pktbuf_release(netif_hdr);
+        return true;
+    }
+    LL_PREPEND(pkt, netif_hdr);
+
+    if (!gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP, GNRC_NETREG_DEMUX_CTX_ALL, pkt)) {
+        gnrc_pktbuf_release(pkt);
+    }
+    return true;
+}
+
+/* answer using the same transport the request came in on */
+static bool _reply(gnrc_pktsnip_t *pkt_in, void* data, size_t len)
+{
+    if (gnrc_pktsnip_search_type(pkt_in, GNRC_NETTYPE_UDP) == NULL) {
+        return _l2_reply(pkt_in, data, len);
+    }
+
+    return _udp_reply(pkt_in, data, len);
+}
+
+static bool _send_ping(int netif, const ipv6_addr_t* addr, uint16_t port,
+                       uint16_t size, uint16_t seq_no)
 {
     test_pingpong_t ping = {
         .type = TEST_PING,
-        .ticks = xtimer_now()
+        .ticks = xtimer_now(),
+        .seq_no = seq_no,
+        .step = range_test_step(),
     };
 
     size = MAX(size, sizeof(ping));
-    return _udp_send(netif, addr, port, &ping, size);
+    return _send(netif, addr, port, &ping, size);
+}
+
+static uint8_t _test_flags(void)
+{
+    return (adaptive_dwell ? TEST_FLAG_ADAPTIVE_DWELL : 0)
+         | (raw_mode ? TEST_FLAG_RAW : 0)
+         | (stream_mode ? TEST_FLAG_STREAM : 0);
+}
+
+/* raw link-layer frames, target is set by the server thread */
+static gnrc_netreg_entry_t ctx_raw = {
+    .demux_ctx = GNRC_NETREG_DEMUX_CTX_ALL,
+};
+
+/* the raw registration also gets every 6LoWPAN frame and holds a
+ * reference on it, so only have it while the test runs in raw mode */
+static void _raw_listen(bool on)
+{
+    static bool registered;
+
+    if (on == registered) {
+        return;
+    }
+
+    if (on) {
+        gnrc_netreg_register(GNRC_NETTYPE_RAW, &ctx_raw);
+    } else {
+        gnrc_netreg_unregister(GNRC_NETTYPE_RAW, &ctx_raw);
+    }
+
+    registered = on;
 }
 
 static kernel_pid_t sender_pid;
@@ -191,63 +562,488 @@ static bool _send_hello(int netif, const ipv6_addr_t* addr, uint16_t port)
 {
     test_hello_t hello = {
         .type   = TEST_HELLO,
+        .flags  = _test_flags(),
+        .step   = resume_step,
         .period = test_period,
     };
 
+    range_test_plan_get(&hello.plan);
     sender_pid = thread_getpid();
-    hello.now = rtt_get_counter();
+    hello.sync.t1 = rtt_get_counter();
 
+    /* the responder only listens for raw frames once it got the HELLO */
     return _udp_send(netif, addr, port, &hello, sizeof(hello));
 }
 
 struct sender_ctx {
     mutex_t mutex;
+    kernel_pid_t pid;
     uint16_t netif;
     uint8_t idx;
     bool running;
+    uint16_t seq_no;
+    uint16_t max_pdu;
+    uint16_t stream_queued;     /* frames handed to the radio */
+    uint8_t stream_frames;      /* radio frames per packet, 0 before the first */
+    bool airtime_done;          /* airtime of the setting was measured */
+    struct {
+        uint32_t ticks;
+        uint32_t tx_start;      /* radio starts sending the ping, 0 if unknown */
+        uint16_t seq_no;
+        bool busy;
+    } inflight[PING_WINDOW_MAX];
 };
 
+static struct sender_ctx sender_ctx[GNRC_NETIF_NUMOF];
+
+/* expire unanswered pings, returns the number of pings still in flight
+ * and the time until the oldest of them times out */
+static unsigned _sender_expire(struct sender_ctx *ctx, uint32_t *next)
+{
+    unsigned pending = 0;
+    unsigned lost = 0;
+    uint32_t now = xtimer_now();
+    uint32_t timeout = range_test_get_timeout(ctx->netif);
+
+    *next = timeout;
+
+    unsigned state = irq_disable();
+    for (unsigned i = 0; i < ping_window; ++i) {
+        if (!ctx->inflight[i].busy) {
+            continue;
+        }
+
+        uint32_t age = now - ctx->inflight[i].ticks;
+        if (age >= timeout) {
+            ctx->inflight[i].busy = false;
+            ++lost;
+        } else {
+            *next = MIN(*next, timeout - age);
+            ++pending;
+        }
+    }
+    irq_restore(state);
+
+    if (lost) {
+        range_test_add_timeout(ctx->netif, lost);
+        _early_check();
+    }
+
+    return pending;
+}
+
+static int _sender_get_slot(struct sender_ctx *ctx)
+{
+    for (unsigned i = 0; i < ping_window; ++i) {
+        if (!ctx->inflight[i].busy) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* match a pong to its ping, returns false for stale or duplicate pongs */
+static bool _sender_ack(kernel_pid_t netif, uint16_t seq_no, uint32_t *tx_start)
+{
+    bool found = false;
+
+    netif -= range_test_radio_pid();
+    if ((unsigned)netif >= range_test_radio_numof()) {
+        return false;
+    }
+
+    struct sender_ctx *ctx = &sender_ctx[netif];
+
+    unsigned state = irq_disable();
+    for (unsigned i = 0; i < ping_window; ++i) {
+        if (ctx->inflight[i].busy && ctx->inflight[i].seq_no == seq_no) {
+            ctx->inflight[i].busy = false;
+            *tx_start = ctx->inflight[i].tx_start;
+            found = true;
+            break;
+        }
+    }
+    irq_restore(state);
+
+    return found;
+}
+
+/* a slot got free, the sender doesn't have to wait for the timeout */
+static void _sender_wake(kernel_pid_t netif)
+{
+    msg_t m = {
+        .type = CUSTOM_MSG_TYPE_PONG
+    };
+
+    msg_try_send(&m, sender_ctx[netif - range_test_radio_pid()].pid);
+}
+
+/* give up on all outstanding pongs, they were neither lost nor received */
+static void _sender_drop(struct sender_ctx *ctx)
+{
+    unsigned pending = 0;
+
+    unsigned state = irq_disable();
+    for (unsigned i = 0; i < ping_window; ++i) {
+        if (ctx->inflight[i].busy) {
+            ctx->inflight[i].busy = false;
+            ++pending;
+        }
+    }
+    irq_restore(state);
+
+    range_test_cancel_measurement(ctx->netif, pending);
+}
+
+/* wait for the outstanding pongs before the setting can be changed,
+ * but not so long that the next dwell is cut short */
+static void _sender_drain(struct sender_ctx *ctx)
+{
+    uint32_t deadline = xtimer_now()
+                      + range_test_control_timeout(range_test_payload_size());
+    uint32_t wait;
+    msg_t m;
+
+    while (_sender_expire(ctx, &wait)) {
+        int32_t left = deadline - xtimer_now();
+        if (left <= 0) {
+            _sender_drop(ctx);
+            break;
+        }
+        xtimer_msg_receive_timeout(&m, MIN(wait, (uint32_t)left));
+    }
+}
+
+/* keep STREAM_QUEUE packets queued at the radio,
+ * returns how long to wait for one of them to be sent */
+static uint32_t _stream_send(struct sender_ctx *ctx)
+{
+    test_pingpong_t data = {
+        .type = TEST_DATA,
+        .step = range_test_step(),
+    };
+    uint32_t timeout = range_test_get_timeout(ctx->netif);
+    size_t size = MAX(range_test_payload_size(), sizeof(data));
+
+    if (ctx->stream_frames) {
+        unsigned sent = range_test_radio_tx_frames(ctx->netif) / ctx->stream_frames;
+        if (ctx->stream_queued >= sent + STREAM_QUEUE) {
+            return timeout;
+        }
+    } else {
+        range_test_radio_tx_begin(ctx->netif);
+    }
+
+    data.seq_no = ctx->seq_no++;
+    if (!_send(ctx->netif, &ipv6_addr_all_nodes_link_local, TEST_PORT, &data, size)) {
+        return timeout;
+    }
+    range_test_begin_measurement(ctx->netif);
+
+    /* first packet of the setting, find out how long it is on air */
+    if (ctx->stream_frames == 0) {
+        uint32_t airtime;
+        unsigned frames = range_test_radio_tx_wait(ctx->netif, timeout, &airtime);
+        range_test_set_airtime(ctx->netif, airtime, frames);
+
+        ctx->stream_frames = MAX(frames, 1);
+        ctx->stream_queued = 0;
+        range_test_radio_tx_begin(ctx->netif);
+        return 0;
+    }
+
+    ctx->stream_queued++;
+    return 0;
+}
+
+/* wait for the queued packets to be sent */
+static void _stream_drain(struct sender_ctx *ctx)
+{
+    if (ctx->stream_frames) {
+        uint32_t airtime;
+        range_test_radio_tx_wait(ctx->netif, range_test_get_timeout(ctx->netif), &airtime);
+    }
+
+    ctx->stream_frames = 0;
+}
+
 static void* range_test_sender(void *arg)
 {
+    msg_t msg_queue[QUEUE_SIZE];
+    msg_init_queue(msg_queue, ARRAY_SIZE(msg_queue));
 
     struct sender_ctx *ctx = arg;
     while (ctx->running) {
 
-        sema_inv_post_mask(&_batch_done, 1 << ctx->idx);
-        mutex_lock(&ctx->mutex);
+        /* the coordinator holds the lock while switching settings */
+        if (!mutex_trylock(&ctx->mutex)) {
+            if (stream_mode) {
+                _stream_drain(ctx);
+            } else {
+                _sender_drain(ctx);
+            }
+            sema_inv_post_mask(&_batch_done, 1 << ctx->idx);
+            mutex_lock(&ctx->mutex);
 
-        if (!ctx->running) {
-            break;
+            if (!ctx->running) {
+                break;
+            }
+
+            ctx->airtime_done = false;
+
+            /* raw frames can't be fragmented */
+            if (gnrc_netapi_get(ctx->netif, NETOPT_MAX_PDU_SIZE, 0,
+                                &ctx->max_pdu, sizeof(ctx->max_pdu)) < 0) {
+                ctx->max_pdu = UINT16_MAX;
+            }
         }
 
-        if (!_send_ping(ctx->netif, &ipv6_addr_all_nodes_link_local,
-                        TEST_PORT, range_test_payload_size())) {
-            printf("send failed, payload %u\n", range_test_payload_size());
-            break;
+        /* nothing to do until the coordinator switches the setting,
+         * the radio may also be done with its own sweep */
+        if (!range_test_radio_active(ctx->netif) ||
+            (raw_mode && range_test_payload_size() > ctx->max_pdu)) {
+            range_test_invalidate(ctx->netif);
+            mutex_unlock(&ctx->mutex);
+
+            msg_t m;
+            msg_receive(&m);
+            continue;
         }
 
-        range_test_begin_measurement(ctx->netif);
+        if (stream_mode) {
+            uint32_t wait = _stream_send(ctx);
+            mutex_unlock(&ctx->mutex);
+
+            /* a lost TX_DONE must not stall the stream */
+            msg_t m;
+            if (wait && xtimer_msg_receive_timeout(&m, wait) < 0) {
+                ctx->stream_queued = range_test_radio_tx_frames(ctx->netif) / ctx->stream_frames;
+            }
+            continue;
+        }
+
+        uint32_t wait;
+        int slot = -1;
+
+        if (_sender_expire(ctx, &wait) < ping_window) {
+            slot = _sender_get_slot(ctx);
+        }
+
+        if (slot >= 0) {
+            ctx->inflight[slot].seq_no = ctx->seq_no++;
+            ctx->inflight[slot].ticks  = xtimer_now();
+            ctx->inflight[slot].busy   = true;
+            range_test_radio_tx_stamp(ctx->netif, &ctx->inflight[slot].tx_start);
+
+            /* first ping of the setting, find out how long it is on air */
+            bool measure_airtime = !ctx->airtime_done;
+            if (measure_airtime) {
+                range_test_radio_tx_begin(ctx->netif);
+            }
+
+            if (!_send_ping(ctx->netif, &ipv6_addr_all_nodes_link_local, TEST_PORT,
+                            range_test_payload_size(), ctx->inflight[slot].seq_no)) {
+                /* most likely out of packet buffer, try again later */
+                ctx->inflight[slot].busy = false;
+                mutex_unlock(&ctx->mutex);
+
+                msg_t m;
+                xtimer_msg_receive_timeout(&m, range_test_get_timeout(ctx->netif));
+                continue;
+            }
+
+            range_test_begin_measurement(ctx->netif);
+
+            if (measure_airtime) {
+                uint32_t airtime;
+                unsigned frames = range_test_radio_tx_wait(ctx->netif,
+                                                           range_test_get_timeout(ctx->netif),
+                                                           &airtime);
+                range_test_set_airtime(ctx->netif, airtime, frames);
+
+                /* don't try again if the radio doesn't report TX events */
+                ctx->airtime_done = true;
+            }
+
+            /* pace the pings if the window is not full yet */
+            if (_sender_expire(ctx, &wait) < ping_window) {
+                wait = MIN(wait, range_test_get_timeout(ctx->netif) / ping_window);
+            }
+        }
 
         mutex_unlock(&ctx->mutex);
-//        printf("[%d] will sleep for %ld µs\n", ctx->netif, xtimer_usec_from_ticks(range_test_get_timeout(ctx->netif)));
-        xtimer_usleep(range_test_get_timeout(ctx->netif));
+
+        /* a pong wakes us up early */
+        msg_t m;
+        xtimer_msg_receive_timeout(&m, wait);
     }
 
     return arg;
 }
 
+static void _checkpoint_save(void)
+{
+    test_checkpoint_t cp = {
+        .period = test_period,
+        .step = range_test_step(),
+        .flags = _test_flags(),
+        .window = ping_window,
+        .early_margin = early_margin,
+    };
+
+    range_test_plan_get(&cp.plan);
+    range_test_store_checkpoint(&cp, sizeof(cp));
+}
+
+/* continue the sweep of the last checkpoint with its parameters */
+static int _checkpoint_resume(void)
+{
+    test_checkpoint_t cp;
+
+    if (range_test_store_checkpoint_load(&cp, sizeof(cp)) < 0) {
+        puts("no sweep to resume");
+        return -1;
+    }
+
+    test_period    = cp.period;
+    adaptive_dwell = cp.flags & TEST_FLAG_ADAPTIVE_DWELL;
+    raw_mode       = cp.flags & TEST_FLAG_RAW;
+    stream_mode    = cp.flags & TEST_FLAG_STREAM;
+    ping_window    = MAX(1, MIN(cp.window, PING_WINDOW_MAX));
+    early_margin   = cp.early_margin;
+    range_test_plan_set(&cp.plan);
+    resume_step    = cp.step;
+
+    return 0;
+}
+
+/* wait for the server to pass on a reply, value -1 matches any content.
+ * Late replies to earlier requests are dropped. */
+static bool _wait_reply(uint16_t type, int32_t value, uint32_t timeout, msg_t *m)
+{
+    uint32_t start = xtimer_now();
+    uint32_t spent = 0;
+
+    while (xtimer_msg_receive_timeout(m, timeout - spent) > 0) {
+        if (m->type == type && (value < 0 || m->content.value == (uint32_t)value)) {
+            return true;
+        }
+
+        spent = xtimer_now() - start;
+        if (spent >= timeout) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+/* announce the switch to the next setting while still on the current one,
+ * at is set to the time of the switch if it was acknowledged */
+static bool _announce_switch(uint32_t *at)
+{
+    uint32_t timeout = range_test_control_timeout(sizeof(test_switch_t));
+    test_switch_t sw = {
+        .type = TEST_SWITCH,
+        .step = range_test_step() + 1,
+    };
+    uint32_t when = rtt_get_counter() + _us_to_ticks(SWITCH_RETRIES * timeout);
+
+    sw.at = range_test_sync_to_remote(when);
+
+    for (unsigned i = 0; i < SWITCH_RETRIES; ++i) {
+        msg_t m;
+
+        sw.sync.t1 = rtt_get_counter();
+        _send(0, &ipv6_addr_all_nodes_link_local, TEST_PORT, &sw, sizeof(sw));
+
+        if (_wait_reply(CUSTOM_MSG_TYPE_SWITCH_ACK, sw.step, timeout, &m)) {
+            *at = when;
+            return true;
+        }
+    }
+
+    /* the responder might not know, it will stick to its timer */
+    puts("\tswitch not acknowledged");
+    return false;
+}
+
+static test_summary_t last_summary;
+
+/* ask the responder what it received of the stream */
+static void _stream_summary(void)
+{
+    uint32_t timeout = range_test_control_timeout(sizeof(test_summary_t));
+    test_summary_t req = {
+        .type = TEST_SUMMARY_REQ,
+        .step = range_test_step(),
+    };
+
+    for (unsigned i = 0; i < SWITCH_RETRIES; ++i) {
+        msg_t m;
+
+        _send(0, &ipv6_addr_all_nodes_link_local, TEST_PORT, &req, sizeof(req));
+
+        if (_wait_reply(CUSTOM_MSG_TYPE_SUMMARY, req.step, timeout, &m)) {
+            for (unsigned r = 0; r < range_test_radio_numof(); ++r) {
+                range_test_add_stream(range_test_radio_pid() + r,
+                                      last_summary.radio[r].pkts,
+                                      last_summary.radio[r].bytes,
+                                      last_summary.radio[r].span_us);
+            }
+            return;
+        }
+    }
+
+    puts("\tno summary");
+}
+
+/* the responder lost track, meet it on the first setting and tell it
+ * where to continue */
+static bool _rendezvous(unsigned step)
+{
+    test_switch_t sw = {
+        .type = TEST_RESYNC,
+        .step = step,
+    };
+
+    range_test_rendezvous();
+
+    for (unsigned i = 0; i < RESYNC_RETRIES; ++i) {
+        msg_t m;
+
+        sw.sync.t1 = rtt_get_counter();
+        _send(0, &ipv6_addr_all_nodes_link_local, TEST_PORT, &sw, sizeof(sw));
+
+        if (_wait_reply(CUSTOM_MSG_TYPE_SWITCH_ACK, step, HELLO_TIMEOUT_US, &m)) {
+            return true;
+        }
+    }
+
+    puts("\tresync failed");
+    return false;
+}
+
 static int _do_range_test(void)
 {
-    mutex_t mutex = MUTEX_INIT_LOCKED;
+    mutex_t *mutex = &_setting_done;
 
     msg_t m;
 
     unsigned tries = HELLO_RETRIES;
 
+    range_test_sync_reset();
+    _raw_listen(raw_mode);
+
+    /* a responder that lost us waits on the first setting of the plan,
+     * we may still be on another one after a reboot or a new plan */
+    range_test_rendezvous();
+
     while (--tries) {
         _send_hello(0, &ipv6_addr_all_nodes_link_local, TEST_PORT);
 
-        if (xtimer_msg_receive_timeout(&m, HELLO_TIMEOUT_US) > 0) {
+        if (_wait_reply(CUSTOM_MSG_TYPE_HELLO_ACK, -1, HELLO_TIMEOUT_US, &m)) {
             break;
         }
     }
@@ -259,10 +1055,17 @@ static int _do_range_test(void)
 
     printf("Handshake complete after %d tries\n", HELLO_RETRIES - tries);
 
-    range_test_start();
+    /* the responder started its timer when it replied */
+    uint32_t start = range_test_sync_to_local(m.content.value);
+
+    range_test_set_adaptive_dwell(adaptive_dwell);
 
-    struct sender_ctx ctx[GNRC_NETIF_NUMOF];
+    range_test_start(resume_step);
+    resume_step = 0;
+
+    struct sender_ctx *ctx = sender_ctx;
     uint32_t sender_msk = 0;
+    unsigned unanswered = 0;
 
     for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
         sender_msk |= 1 << i;
@@ -272,29 +1075,95 @@ static int _do_range_test(void)
         ctx[i].netif = range_test_radio_pid() + i;
         ctx[i].idx = i;
         ctx[i].running = true;
-        thread_create(test_sender_stack[i], sizeof(test_sender_stack[i]),
-                      THREAD_PRIORITY_MAIN - 1, THREAD_CREATE_STACKTEST,
-                      range_test_sender, &ctx[i], "pinger");
+        ctx[i].stream_frames = 0;
+        ctx[i].airtime_done = false;
+        memset(ctx[i].inflight, 0, sizeof(ctx[i].inflight));
+        ctx[i].pid = thread_create(test_sender_stack[i], sizeof(test_sender_stack[i]),
+                                   THREAD_PRIORITY_MAIN - 1, THREAD_CREATE_STACKTEST,
+                                   range_test_sender, &ctx[i], "pinger");
     }
 
-    last_alarm = rtt_get_counter() + test_period;
-    rtt_set_alarm(last_alarm, _rtt_alarm, &mutex);
+    mutex_trylock(mutex);
+    rtt_set_alarm(start + _dwell_ticks(0), _rtt_alarm, mutex);
+
+    bool checkpoint = false;
+
+    while (1) {
+        early_armed = true;
 
-    do {
         for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
             mutex_unlock(&ctx[i].mutex);
         }
 
-        mutex_lock(&mutex);
+        /* report the previous setting while the senders measure,
+         * its records have to be queued before the checkpoint */
+        range_test_report();
+        if (checkpoint) {
+            _checkpoint_save();
+            checkpoint = false;
+        }
+
+        mutex_lock(mutex);
+
+        unsigned state = irq_disable();
+        early_armed = false;
+        irq_restore(state);
+
+        /* the alarm and an early end may have raced */
+        rtt_clear_alarm();
+        mutex_trylock(mutex);
+
         sema_inv_init(&_batch_done, sender_msk);
 
         for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+            msg_t stop = {
+                .type = CUSTOM_MSG_TYPE_STOP
+            };
+
             mutex_lock(&ctx[i].mutex);
+            msg_try_send(&stop, ctx[i].pid);
         }
 
         /* can't change the modulation if the radio is still sending */
         sema_inv_wait(&_batch_done);
-    } while (range_test_set_next_modulation());
+
+        /* pongs for pings of the previous setting must not be counted */
+        for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+            memset(ctx[i].inflight, 0, sizeof(ctx[i].inflight));
+        }
+
+        if (stream_mode) {
+            _stream_summary();
+        }
+
+        uint32_t at = start + _fallback_ticks();
+        unsigned next = range_test_step() + 1;
+
+        if (_announce_switch(&at)) {
+            unanswered = 0;
+        } else if (++unanswered >= RESYNC_STEPS && next < range_test_step_numof()) {
+            unanswered = 0;
+            if (_rendezvous(next)) {
+                at = rtt_get_counter();
+            }
+        }
+
+        /* both sides switch at the same time */
+        if ((int32_t)(at - rtt_get_counter()) > 0) {
+            rtt_set_alarm(at, _rtt_alarm, mutex);
+            mutex_lock(mutex);
+        }
+
+        if (!range_test_set_next_modulation()) {
+            range_test_report();
+            break;
+        }
+
+        checkpoint = range_test_setting_boundary();
+
+        start = at;
+        rtt_set_alarm(start + _dwell_ticks(0), _rtt_alarm, mutex);
+    }
 
 
     for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
@@ -304,8 +1173,11 @@ static int _do_range_test(void)
 
     rtt_clear_alarm();
 
+    range_test_sync_print();
     range_test_end();
-    range_test_print_results();
+
+    /* the sweep is complete */
+    range_test_store_checkpoint_clear();
 
     xtimer_sleep(1);
 
@@ -316,6 +1188,10 @@ static void *range_test_coordinator(void *ctx)
 {
     (void)ctx;
 
+    /* the server passes on replies without blocking */
+    msg_t msg_queue[QUEUE_SIZE];
+    msg_init_queue(msg_queue, ARRAY_SIZE(msg_queue));
+
     while (1) {
         mutex_lock(&_test_start);
         _do_range_test();
@@ -324,21 +1200,145 @@ static void *range_test_coordinator(void *ctx)
     return 0;
 }
 
-#define CUSTOM_MSG_TYPE_NEXT_SETTING    (0x0001)
-
 static void _rtt_next_setting(void* arg)
 {
     gnrc_netreg_entry_t *ctx = arg;
     msg_t m = {
-        .type = CUSTOM_MSG_TYPE_NEXT_SETTING
+        .type = CUSTOM_MSG_TYPE_NEXT_SETTING,
+        .content.value = range_test_step(),
     };
 
-    last_alarm += test_period;
-    rtt_set_alarm(last_alarm, _rtt_next_setting, arg);
-
     msg_send(&m, ctx->target.pid);
 }
 
+static bool _next_setting(void)
+{
+    if (!range_test_set_next_modulation()) {
+        rtt_clear_alarm();
+        follow.active = false;
+        puts("Test done.");
+        range_test_init();
+        return false;
+    }
+
+    return true;
+}
+
+/* responder: move on and wait for the next announcement */
+static void _advance(gnrc_netreg_entry_t *ctx)
+{
+    if (_next_setting()) {
+        last_alarm += _fallback_ticks();
+        rtt_set_alarm(last_alarm, _rtt_next_setting, ctx);
+    }
+}
+
+/* responder: frames of the stream of the current step */
+static struct {
+    uint16_t step;
+    uint32_t pkts;
+    uint32_t bytes;
+    uint32_t first;
+    uint32_t last;
+} stream_rx[GNRC_NETIF_NUMOF];
+
+/* responder: pings of the current step, bit n of seen is highest - n */
+static struct {
+    uint16_t step;
+    uint16_t pkts;
+    uint16_t highest;
+    uint16_t dups;
+    uint16_t reordered;
+    uint32_t seen;
+} ping_rx[GNRC_NETIF_NUMOF];
+
+static void _stream_count(kernel_pid_t netif, uint16_t step, size_t size)
+{
+    unsigned i = netif - range_test_radio_pid();
+    uint32_t now = xtimer_now();
+
+    if (i >= range_test_radio_numof()) {
+        return;
+    }
+
+    if (stream_rx[i].step != step || stream_rx[i].pkts == 0) {
+        stream_rx[i].step  = step;
+        stream_rx[i].pkts  = 1;
+        stream_rx[i].bytes = 0;
+        stream_rx[i].first = now;
+        stream_rx[i].last  = now;
+        return;
+    }
+
+    stream_rx[i].pkts++;
+    stream_rx[i].bytes += size;
+    stream_rx[i].last   = now;
+}
+
+static void _ping_count(kernel_pid_t netif, test_pingpong_t *pp)
+{
+    unsigned i = netif - range_test_radio_pid();
+
+    pp->rx_count     = 0;
+    pp->rx_dups      = 0;
+    pp->rx_reordered = 0;
+
+    if (i >= range_test_radio_numof()) {
+        return;
+    }
+
+    if (ping_rx[i].step != pp->step || ping_rx[i].pkts == 0) {
+        ping_rx[i].step    = pp->step;
+        ping_rx[i].pkts      = 0;
+        ping_rx[i].highest   = pp->seq_no;
+        ping_rx[i].dups      = 0;
+        ping_rx[i].reordered = 0;
+        ping_rx[i].seen      = 0;
+    }
+
+    int16_t ahead = pp->seq_no - ping_rx[i].highest;
+
+    if (ahead > 0) {
+        ping_rx[i].seen = ahead < 32 ? ping_rx[i].seen << ahead : 0;
+        ping_rx[i].highest = pp->seq_no;
+        ahead = 0;
+    }
+
+    /* older than the window counts as received, as it can't be told apart */
+    if (-ahead < 32 && (ping_rx[i].seen & (1UL << -ahead))) {
+        ping_rx[i].dups++;
+    } else {
+        if (-ahead < 32) {
+            ping_rx[i].seen |= 1UL << -ahead;
+        }
+        if (ahead) {
+            ping_rx[i].reordered++;
+        }
+        ping_rx[i].pkts++;
+    }
+
+    /* totals, so a lost pong doesn't lose what was counted for its ping */
+    pp->rx_count     = ping_rx[i].pkts;
+    pp->rx_dups      = ping_rx[i].dups;
+    pp->rx_reordered = ping_rx[i].reordered;
+}
+
+/* responder: we missed a switch, follow the coordinator */
+static void _follow(uint16_t step, uint32_t now, gnrc_netreg_entry_t *ctx)
+{
+    follow.heard = true;
+
+    if (!follow.active || step == range_test_step()) {
+        return;
+    }
+
+    printf("out of sync, skip to step %u\n", step);
+    range_test_goto(step);
+    follow.silent = 0;
+    last_alarm = now + _fallback_ticks();
+    rtt_set_alarm(last_alarm, _rtt_next_setting, ctx);
+}
+
 static void* range_test_server(void *arg)
 {
     msg_t msg, reply = {
@@ -359,11 +1359,16 @@ static void* range_test_server(void *arg)
     /* register thread for UDP traffic on this port */
     gnrc_netreg_register(GNRC_NETTYPE_UDP, &ctx);
 
+    /* raw link-layer frames are registered for with the test */
+    ctx_raw.target.pid = thread_getpid();
+
     puts("listening…");
 
     while (1) {
         msg_receive(&msg);
         gnrc_pktsnip_t *pkt = msg.content.ptr;
+        uint32_t now = rtt_get_counter();
+        uint32_t now_us = xtimer_now();
 
         LED0_TOGGLE;
 
@@ -378,54 +1383,243 @@ static void* range_test_server(void *arg)
         case GNRC_NETAPI_MSG_TYPE_SND:
             continue;
         case CUSTOM_MSG_TYPE_NEXT_SETTING:
-            if (!range_test_set_next_modulation()) {
-                rtt_clear_alarm();
-                puts("Test done.");
-                range_test_init();
+            /* the coordinator may have ended the setting already */
+            if (msg.content.value != range_test_step()) {
+                continue;
+            }
+
+            if (follow.heard) {
+                follow.silent = 0;
+            } else if (++follow.silent >= RESYNC_STEPS) {
+                /* wait for the coordinator's TEST_RESYNC */
+                range_test_rendezvous();
+                continue;
             }
+
+            follow.heard = false;
+            _advance(&ctx);
             continue;
         }
 
+        /* raw registration also gets all the 6LoWPAN frames */
+        if (pkt->type == GNRC_NETTYPE_RAW && pkt->next &&
+            pkt->next->type == GNRC_NETTYPE_NETIF && pp->type > TEST_RAW_TYPE_MAX) {
+            gnrc_pktbuf_release(pkt);
+            continue;
+        }
+
+        /* requests are turned into their replies in place */
+        gnrc_pktsnip_t *tmp = gnrc_pktbuf_start_write(pkt);
+        if (tmp == NULL) {
+            gnrc_pktbuf_release(pkt);
+            continue;
+        }
+        pkt   = tmp;
+        hello = pkt->data;
+        pp    = pkt->data;
+
         switch (pp->type) {
         case TEST_HELLO:
-            rtt_set_counter(hello->now);
             test_period = hello->period;
+            range_test_set_adaptive_dwell(hello->flags & TEST_FLAG_ADAPTIVE_DWELL);
+            /* the airtime model has to match the coordinator's */
+            raw_mode = hello->flags & TEST_FLAG_RAW;
+            _raw_listen(raw_mode);
+            stream_mode = hello->flags & TEST_FLAG_STREAM;
+            range_test_plan_set(&hello->plan);
 
             pp->type = TEST_HELLO_ACK;
-            _udp_reply(pkt, pkt->data, pkt->size);
+            hello->sync.t2 = now;
+            hello->sync.t3 = rtt_get_counter();
+            _reply(pkt, pkt->data, pkt->size);
 
             LED0_ON;
 
-            last_alarm = rtt_get_counter() + test_period;
+            range_test_goto(hello->step);
+            memset(stream_rx, 0, sizeof(stream_rx));
+            memset(ping_rx, 0, sizeof(ping_rx));
+            follow.active = true;
+            follow.heard  = false;
+            follow.silent = 0;
+
+            last_alarm = hello->sync.t3 + _fallback_ticks();
             rtt_set_alarm(last_alarm, _rtt_next_setting, &ctx);
 
             break;
         case TEST_HELLO_ACK:
+        {
+            msg_t m = {
+                .type = CUSTOM_MSG_TYPE_HELLO_ACK,
+                .content.value = hello->sync.t3,
+            };
+
             puts("got HELLO-ACK");
-            rtt_set_counter(hello->now);
-            msg_send(&msg, sender_pid);
+            range_test_sync_add(hello->sync.t1, hello->sync.t2, hello->sync.t3, now);
+            msg_try_send(&m, sender_pid);
             break;
+        }
         case TEST_PING:
+        {
+            kernel_pid_t netif = 0;
             pp->type = TEST_PONG;
-            _get_rssi(pkt, NULL, &pp->lqi, &pp->rssi);
-            _udp_reply(pkt, pkt->data, pkt->size);
+            _get_rssi(pkt, &netif, &pp->lqi, &pp->rssi);
+            _ping_count(netif, pp);
+
+            /* start at the radio if possible, the stack is part of the turnaround */
+            uint32_t rx_done = now_us;
+            _rx_done(netif, now_us, &rx_done);
+            pp->rx_time = now - _us_to_ticks(xtimer_usec_from_ticks(now_us - rx_done));
+            pp->turnaround = MIN(xtimer_usec_from_ticks(xtimer_now() - rx_done), UINT16_MAX);
+
+            uint16_t step = pp->step;
+            if (_reply_in_place(pkt)) {
+                pkt = NULL;
+            } else {
+                _reply(pkt, pkt->data, pkt->size);
+            }
+            _follow(step, now, &ctx);
+            break;
+        }
+        case TEST_DATA:
+        {
+            kernel_pid_t netif = 0;
+            uint8_t lqi;
+            int8_t rssi;
+            _get_rssi(pkt, &netif, &lqi, &rssi);
+            /* stray frames of an earlier streaming run */
+            if (stream_mode) {
+                _stream_count(netif, pp->step, pkt->size);
+            }
+            _follow(pp->step, now, &ctx);
             break;
+        }
+        case TEST_SUMMARY_REQ:
+        {
+            test_summary_t *req = pkt->data;
+            test_summary_t sum = {
+                .type = TEST_SUMMARY,
+                .step = req->step,
+            };
+
+            follow.heard = true;
+
+            for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+                if (stream_rx[i].step == req->step) {
+                    sum.radio[i].pkts    = stream_rx[i].pkts;
+                    sum.radio[i].bytes   = stream_rx[i].bytes;
+                    sum.radio[i].span_us = stream_rx[i].last - stream_rx[i].first;
+                }
+            }
+
+            _reply(pkt, &sum, sizeof(sum));
+            break;
+        }
+        case TEST_SUMMARY:
+        {
+            test_summary_t *sum = pkt->data;
+            msg_t m = {
+                .type = CUSTOM_MSG_TYPE_SUMMARY,
+                .content.value = sum->step,
+            };
+
+            if (pkt->size >= sizeof(*sum)) {
+                last_summary = *sum;
+                msg_try_send(&m, sender_pid);
+            }
+            break;
+        }
         case TEST_PONG:
         {
             kernel_pid_t netif = 0;
             uint8_t lqi = 0;
             int8_t rssi = 0;
             _get_rssi(pkt, &netif, &lqi, &rssi);
-            range_test_add_measurement(netif, xtimer_now() - pp->ticks,
+            if (pp->step != range_test_step()) {
+                break;
+            }
+            /* late pongs still tell what made it to the responder */
+            range_test_add_forward(netif, pp->rx_count, pp->rx_dups, pp->rx_reordered);
+            uint32_t tx_start;
+            if (!_sender_ack(netif, pp->seq_no, &tx_start)) {
+                range_test_add_late(netif);
+                break;
+            }
+            range_test_add_measurement(netif, now_us - pp->ticks,
                                        rssi, pp->rssi, lqi, pp->lqi,
                                        pkt->size);
+            _oneway(netif, pp, now, now_us);
+            _radio_time(netif, pp, tx_start, now_us);
+            _sender_wake(netif);
+            _early_check();
+            break;
+        }
+        case TEST_SWITCH:
+        {
+            test_switch_t *sw = pkt->data;
+
+            follow.heard = true;
+
+            /* repeated announcements are acknowledged again */
+            if (sw->step != range_test_step() + 1) {
+                break;
+            }
+
+            sw->type = TEST_SWITCH_ACK;
+            sw->sync.t2 = now;
+            sw->sync.t3 = rtt_get_counter();
+            _reply(pkt, pkt->data, pkt->size);
+
+            last_alarm = sw->at;
+            if ((int32_t)(sw->at - rtt_get_counter()) > 0) {
+                rtt_set_alarm(last_alarm, _rtt_next_setting, &ctx);
+            } else {
+                last_alarm = rtt_get_counter();
+                _advance(&ctx);
+            }
+            break;
+        }
+        case TEST_RESYNC:
+        {
+            test_switch_t *sw = pkt->data;
+
+            if (!follow.active || sw->step >= range_test_step_numof()) {
+                break;
+            }
+
+            sw->type = TEST_SWITCH_ACK;
+            sw->sync.t2 = now;
+            sw->sync.t3 = rtt_get_counter();
+            _reply(pkt, pkt->data, pkt->size);
+
+            printf("resync to step %u\n", sw->step);
+            range_test_goto(sw->step);
+            follow.heard  = true;
+            follow.silent = 0;
+
+            last_alarm = rtt_get_counter() + _fallback_ticks();
+            rtt_set_alarm(last_alarm, _rtt_next_setting, &ctx);
+            break;
+        }
+        case TEST_SWITCH_ACK:
+        {
+            test_switch_t *sw = pkt->data;
+            msg_t m = {
+                .type = CUSTOM_MSG_TYPE_SWITCH_ACK,
+                .content.value = sw->step,
+            };
+
+            range_test_sync_add(sw->sync.t1, sw->sync.t2, sw->sync.t3, now);
+            msg_try_send(&m, sender_pid);
             break;
         }
         default:
             printf("got '%s'\n", (char*) pkt->data);
         }
 
-        gnrc_pktbuf_release(pkt);
+        /* NULL if it went out as the reply */
+        if (pkt) {
+            gnrc_pktbuf_release(pkt);
+        }
     }
 
     return arg;
@@ -438,10 +1632,89 @@ static inline void _btn_cb(void *ctx)
 
 static int _range_test_cmd(int argc, char** argv)
 {
-    if (argc > 1) {
-        int period = atoi(argv[1]);
+    /* the parameters and the plan are in use */
+    if (range_test_sweeping()) {
+        puts("a range test is already running");
+        return -1;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "resume") == 0) {
+        if (_checkpoint_resume() < 0) {
+            return -1;
+        }
+
+        mutex_unlock(&_test_start);
+        return 0;
+    }
+
+    /* a new sweep */
+    resume_step = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            int window = atoi(argv[++i]);
+            if (window <= 0 || window > PING_WINDOW_MAX) {
+                printf("window must be 1…%u\n", PING_WINDOW_MAX);
+                return -1;
+            }
+            ping_window = window;
+            continue;
+        }
+
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "adaptive") == 0) {
+                adaptive_dwell = true;
+            } else if (strcmp(argv[i], "fixed") == 0) {
+                adaptive_dwell = false;
+            } else {
+                printf("unknown dwell mode '%s', use 'fixed' or 'adaptive'\n", argv[i]);
+                return -1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "stream") == 0) {
+                stream_mode = true;
+            } else if (strcmp(argv[i], "ping") == 0) {
+                stream_mode = false;
+            } else {
+                printf("unknown mode '%s', use 'ping' or 'stream'\n", argv[i]);
+                return -1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            int margin = atoi(argv[++i]);
+            if (margin < 0 || margin > 50) {
+                puts("PDR margin must be 0…50 %");
+                return -1;
+            }
+            early_margin = margin;
+            continue;
+        }
+
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "l2") == 0) {
+                raw_mode = true;
+            } else if (strcmp(argv[i], "udp") == 0) {
+                raw_mode = false;
+            } else {
+                printf("unknown transport '%s', use 'udp' or 'l2'\n", argv[i]);
+                return -1;
+            }
+            continue;
+        }
+
+        int period = atoi(argv[i]);
         if (period == 0) {
-            printf("usage: %s [period]\n", argv[0]);
+            printf("usage: %s [-w window] [-t udp|l2] [-m ping|stream] [-d fixed|adaptive] "
+                   "[-e margin] [period]\n"
+                   "       %s resume\n", argv[0], argv[0]);
             return -1;
         }
         test_period = period * RTT_FREQUENCY;
@@ -456,12 +1729,13 @@ static int _do_ping(int argc, char** argv)
     (void) argc;
     (void) argv;
 
-    return !_send_ping(0, &ipv6_addr_all_nodes_link_local, TEST_PORT, 16);
+    return !_send_ping(0, &ipv6_addr_all_nodes_link_local, TEST_PORT, 16, 0);
 }
 
 static const shell_command_t shell_commands[] = {
     { "range_test", "Iterates over radio settings", _range_test_cmd },
     { "ping_test", "send single ping to all nodes", _do_ping },
+    { "range_plan", "Selects the settings and payloads to sweep", range_test_plan_cmd },
     { NULL, NULL, NULL }
 };
 
@@ -482,7 +1756,15 @@ int main(void)
                   range_test_coordinator, NULL, "range test sender");
 
 
+    /* the test header is sent even for smaller payloads */
+    range_test_set_payload_min(sizeof(test_pingpong_t));
     range_test_init();
+
+    test_checkpoint_t cp;
+    if (range_test_store_checkpoint_load(&cp, sizeof(cp)) == 0) {
+        printf("unfinished sweep at step %u, 'range_test resume' continues it\n", cp.step);
+    }
+
 #ifdef BTN0_PIN
     gpio_init_int(BTN0_PIN, BTN0_MODE, GPIO_FALLING, _btn_cb, &_test_start);
 #endif
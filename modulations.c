@@ -18,9 +18,13 @@
  * @}
  */
 
+#include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
+#include "bitarithm.h"
 #include "thread.h"
 #include "mutex.h"
 #include "net/gnrc.h"
@@ -28,6 +32,7 @@
 #include "shell.h"
 #include "shell_commands.h"
 #include "range_test.h"
+#include "range_log.h"
 
 #ifdef MODULE_NETDEV_IEEE802154_MR_OFDM
 #define TEST_OFDM
@@ -317,644 +322,1724 @@ static const netopt_list_t fsk_fec = {
 };
 #endif
 
+/* index into plan_payload */
 static uint8_t _payload_idx;
 static const uint16_t payloads[] = {
     16, 128, 512, 1024
 };
-/* tx times based on slowest modulation */
-/* since we can't get proper TX confirmatio from RIOT :( */
+/* the test header doesn't fit into the smallest payloads, they are padded */
+static uint16_t payload_min;
+/* tx times based on slowest modulation, the first payload padded to 24 byte */
+/* used until the airtime of the current setting has been measured */
 static const uint32_t max_delay_ms[] = {
-    185, 500, 1600, 3000
+    210, 500, 1600, 3000
 };
 
+/* give up on a busy radio after that long, a frame of the slowest setting fits */
+#define RECONF_TIMEOUT_US   (3500 * US_PER_MS)
+/* look again even without an event, a reception may be aborted without one */
+#define RECONF_RECHECK_US   (10 * US_PER_MS)
+
+/* granularity term of the retransmission timeout */
+#define RTO_MIN_US      (1 * US_PER_MS)
+/* allowance for the stack on both nodes before the first RTT sample */
+#define TURNAROUND_US   (10 * US_PER_MS)
+#define BACKOFF_MAX     (8)
+
+/* with adaptive dwell, stay on a setting long enough for that many pings */
+#define DWELL_PINGS     (100)
+#define DWELL_MIN_MS    (500)
+
+static bool adaptive_dwell;
+
+/* squared z-score of the PDR confidence interval, in 1/100 (1.96² for 95 %) */
+#ifndef EARLY_STOP_Z2
+#define EARLY_STOP_Z2   (384)
+#endif
+
+static uint32_t step_start;
+
+/* RTT histogram of the current setting, two buckets per octave,
+ * the first bucket holds everything below 2^RTT_HIST_BASE_LOG2 µs */
+#define RTT_HIST_BUCKETS    (24)
+#define RTT_HIST_BASE_LOG2  (9)
+/* percentile of a setting without any RTT */
+#define RTT_PCT_NONE        (UINT8_MAX)
+
+static uint16_t rtt_hist[GNRC_NETIF_NUMOF][RTT_HIST_BUCKETS];
+static const uint8_t rtt_percentiles[RTT_PERCENTILES_NUMOF] = { 50, 90, 99 };
+
+/* running sums of the current setting, samples are taken relative to
+ * the first one so the sums stay small and the hot path needs no division */
+typedef struct {
+    int32_t first;
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    uint64_t sum_sq;
+} stat_acc_t;
+
+enum {
+    STAT_RSSI_LOCAL,
+    STAT_RSSI_REMOTE,
+    STAT_LQI_LOCAL,
+    STAT_LQI_REMOTE,
+    STAT_RTT,
+    STAT_UPLINK,
+    STAT_TURNAROUND,
+    STAT_DOWNLINK,
+    STAT_RADIO,
+    STAT_STACK,
+    STAT_NUMOF
+};
+
+static stat_acc_t rx_stats[GNRC_NETIF_NUMOF][STAT_NUMOF];
+
+/* print a value in 1/10 */
+#define TENTHS_FMT  "%s%u.%u"
+#define TENTHS(v)   (v) < 0 ? "-" : "", (unsigned)abs(v) / 10, (unsigned)abs(v) % 10
+
+/* radios are not on the settings of idx, e.g. on the rendezvous setting */
+static bool reapply;
+
+/* round of the schedule, each radio is on its own setting in a round */
 static unsigned idx;
-static test_result_t *results[GNRC_NETIF_NUMOF];
+
+/* the coordinator is sweeping, the plan must not change under it */
+static bool sweeping;
+/* only the setting that is being measured is kept in RAM,
+ * completed settings are written out and evicted */
+static test_result_t results[GNRC_NETIF_NUMOF];
+static bool setting_failed[GNRC_NETIF_NUMOF];
+
+/* results of the settings just left, reported while the next one runs */
+static struct {
+    test_result_t result;
+    uint16_t step;
+    bool pending;
+} report[GNRC_NETIF_NUMOF];
+
+static unsigned _hist_bucket(uint32_t rtt)
+{
+    if (rtt < (1UL << RTT_HIST_BASE_LOG2)) {
+        return 0;
+    }
+
+    unsigned msb  = bitarithm_msb(rtt);
+    unsigned half = (rtt >> (msb - 1)) & 1;
+
+    return MIN(1 + 2 * (msb - RTT_HIST_BASE_LOG2) + half, RTT_HIST_BUCKETS - 1);
+}
+
+/* upper bound of a bucket in µs */
+static uint32_t _hist_bucket_max(unsigned bucket)
+{
+    if (bucket == 0) {
+        return 1UL << RTT_HIST_BASE_LOG2;
+    }
+
+    /* the last bucket holds everything up to the longest timeout */
+    if (bucket == RTT_HIST_BUCKETS - 1) {
+        return max_delay_ms[ARRAY_SIZE(max_delay_ms) - 1] * US_PER_MS;
+    }
+
+    uint32_t lower = 1UL << (RTT_HIST_BASE_LOG2 + (bucket - 1) / 2);
+    return (bucket & 1) ? lower + lower / 2 : 2 * lower;
+}
+
+static void _hist_add(uint16_t *hist, uint32_t rtt)
+{
+    unsigned bucket = _hist_bucket(rtt);
+
+    /* keep the shape if a bucket overflows */
+    if (hist[bucket] == UINT16_MAX) {
+        for (unsigned i = 0; i < RTT_HIST_BUCKETS; ++i) {
+            hist[i] /= 2;
+        }
+    }
+
+    hist[bucket]++;
+}
+
+/* store the percentiles in the result and start over */
+static void _hist_finish(uint16_t *hist, test_result_t *result)
+{
+    uint32_t total = 0;
+
+    for (unsigned i = 0; i < RTT_HIST_BUCKETS; ++i) {
+        total += hist[i];
+    }
+
+    /* no RTT is not the same as one in the first bucket */
+    if (total == 0) {
+        memset(result->rtt_pct, RTT_PCT_NONE, sizeof(result->rtt_pct));
+        return;
+    }
+
+    for (unsigned p = 0; p < RTT_PERCENTILES_NUMOF; ++p) {
+        uint32_t target = (total * rtt_percentiles[p] + 99) / 100;
+        uint32_t sum = 0;
+        unsigned i = 0;
+
+        while (i < RTT_HIST_BUCKETS - 1 && (sum += hist[i]) < target) {
+            ++i;
+        }
+
+        result->rtt_pct[p] = i;
+    }
+
+    memset(hist, 0, RTT_HIST_BUCKETS * sizeof(*hist));
+}
+
+static void _stat_add(stat_acc_t *s, int32_t x, bool first)
+{
+    if (first) {
+        s->first  = x;
+        s->min    = x;
+        s->max    = x;
+        s->sum    = 0;
+        s->sum_sq = 0;
+        return;
+    }
+
+    int32_t d = x - s->first;
+    s->sum    += d;
+    s->sum_sq += (int64_t)d * d;
+    s->min     = MIN(s->min, x);
+    s->max     = MAX(s->max, x);
+}
+
+static uint32_t _isqrt(uint64_t x)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (x >= res + bit) {
+            x  -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return res;
+}
+
+/* mean and standard deviation of n samples, multiplied by scale */
+static void _stat_finish(const stat_acc_t *s, unsigned n, unsigned scale,
+                         int32_t *mean, uint32_t *sdev)
+{
+    if (n == 0) {
+        *mean = 0;
+        *sdev = 0;
+        return;
+    }
+
+    int64_t m   = s->sum * (int64_t)scale / (int64_t)n;
+    int64_t var = (int64_t)(s->sum_sq * scale * scale / n) - m * m;
+
+    *mean = s->first * (int32_t)scale + m;
+    *sdev = _isqrt(var > 0 ? var : 0);
+}
+
+static void _stat_finish_link(const stat_acc_t *s, unsigned n, link_stat_t *out)
+{
+    int32_t mean;
+    uint32_t sdev;
+
+    _stat_finish(s, n, 10, &mean, &sdev);
+
+    out->mean = mean;
+    out->sdev = sdev;
+    out->min  = n ? s->min : 0;
+    out->max  = n ? s->max : 0;
+}
+
+/* store the summary of the current setting in the result */
+static void _stats_finish(stat_acc_t *stats, test_result_t *result)
+{
+    unsigned n = result->rx_samples;
+    int32_t mean;
+    uint32_t sdev;
+
+    _stat_finish_link(&stats[STAT_RSSI_LOCAL], n, &result->rssi[0]);
+    _stat_finish_link(&stats[STAT_RSSI_REMOTE], n, &result->rssi[1]);
+    _stat_finish_link(&stats[STAT_LQI_LOCAL], n, &result->lqi[0]);
+    _stat_finish_link(&stats[STAT_LQI_REMOTE], n, &result->lqi[1]);
+
+    _stat_finish(&stats[STAT_RTT], n, 1, &mean, &result->rtt.sdev);
+    result->rtt.mean = mean;
+    result->rtt.min  = n ? stats[STAT_RTT].min : 0;
+    result->rtt.max  = n ? stats[STAT_RTT].max : 0;
+
+    _stat_finish(&stats[STAT_UPLINK], n, 1, &mean, &sdev);
+    result->uplink_us = mean;
+    _stat_finish(&stats[STAT_TURNAROUND], n, 1, &mean, &sdev);
+    result->turnaround_us = mean;
+    _stat_finish(&stats[STAT_DOWNLINK], n, 1, &mean, &sdev);
+    result->downlink_us = mean;
+
+    /* not every pong can be matched to its radio events */
+    _stat_finish(&stats[STAT_RADIO], result->radio_samples, 1, &mean, &sdev);
+    result->radio_us = mean;
+    _stat_finish(&stats[STAT_STACK], result->radio_samples, 1, &mean, &sdev);
+    result->stack_us = mean;
+
+    memset(stats, 0, STAT_NUMOF * sizeof(*stats));
+}
+
+/* at86rf215 refuses to be configured while it is sending or receiving */
+static int _netapi_try_set(kernel_pid_t pid, netopt_t opt, const void *data, size_t data_len)
+{
+    mutex_t idle = MUTEX_INIT_LOCKED;
+    uint32_t start = xtimer_now();
+    int res;
+
+    while (1) {
+        range_test_radio_idle_arm(pid, &idle);
+        res = gnrc_netapi_set(pid, opt, 0, data, data_len);
+
+        if (res != -EBUSY || xtimer_now() - start >= RECONF_TIMEOUT_US) {
+            break;
+        }
+
+        xtimer_mutex_lock_timeout(&idle, RECONF_RECHECK_US);
+    }
+
+    range_test_radio_idle_arm(pid, NULL);
+    return res;
+}
+
+static bool _netapi_set(unsigned radio, netopt_t opt, const void *data, size_t data_len)
+{
+    kernel_pid_t pid = range_test_radio_pid() + radio;
+
+    if (_netapi_try_set(pid, opt, data, data_len) < 0) {
+        printf("[%d] failed setting %x to %x\n", pid, opt, *(uint8_t*) data);
+
+        /* applies to all payload sizes of this setting */
+        setting_failed[radio] = true;
+        results[radio].invalid = true;
+        return false;
+    }
+
+    return true;
+}
+
+static void _netapi_set_forall(netopt_t opt, const void *data, size_t data_len)
+{
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        _netapi_set(i, opt, data, data_len);
+    }
+}
+
+static void _set_from_netopt_list(const netopt_list_t *l, unsigned idx) {
+    printf("%s = %s", l->name, l->settings[idx].name);
+}
+
+static int _print_from_netopt_list(char *str, size_t size, const netopt_list_t *l, unsigned idx)
+{
+    return snprintf(str, size, "%s = %s", l->name, l->settings[idx].name);
+}
+
+static int _advance_str(char **str, size_t *len, int res)
+{
+    /* don't run past the buffer if the output got truncated */
+    if ((size_t)res >= *len) {
+        res = *len ? *len - 1 : 0;
+    }
+
+    *str += res;
+    *len -= res;
+    return res;
+}
+
+/* a PHY and the ordered list of options that are swept for it,
+ * the first option is the most significant digit of the setting index */
+#define SWEEP_DIM_MAX   RANGE_PLAN_DIM_MAX
+
+typedef struct {
+    const char *name;
+    uint8_t phy;
+    uint8_t dim_numof;
+    const netopt_list_t *dim[SWEEP_DIM_MAX];
+} sweep_phy_t;
+
+static const sweep_phy_t sweep_phys[] = {
+#ifdef TEST_OQPSK
+    {
+        .name = "O-QPSK",
+        .phy  = IEEE802154_PHY_MR_OQPSK,
+        .dim_numof = 2,
+        .dim  = { &oqpsk_rates, &oqpsk_chips },
+    },
+#endif
+#ifdef TEST_LEGCAY_OQPSK
+    {
+        .name = "O-QPSK",
+        .phy  = IEEE802154_PHY_OQPSK,
+        .dim_numof = 1,
+        .dim  = { &legacy_oqpsk_rates },
+    },
+#endif
+#ifdef TEST_OFDM
+    {
+        .name = "OFDM",
+        .phy  = IEEE802154_PHY_MR_OFDM,
+        .dim_numof = 2,
+        .dim  = { &ofdm_options, &ofdm_mcs },
+    },
+#endif
+#ifdef TEST_FSK
+    {
+        .name = "FSK",
+        .phy  = IEEE802154_PHY_MR_FSK,
+        .dim_numof = 4,
+        .dim  = { &fsk_srate, &fsk_idx, &fsk_mord, &fsk_fec },
+    },
+#endif
+};
+
+/* precomputed by _sweep_init() */
+static struct {
+    uint16_t first;                 /* first setting index of the PHY */
+    uint16_t stride[SWEEP_DIM_MAX]; /* weight of each option in the index */
+} sweep_layout[ARRAY_SIZE(sweep_phys)];
+static unsigned sweep_combinations;
+
+/* upper bound of sweep_combinations */
+#define SWEEP_SETTINGS_MAX  (512)
+
+/* every radio sweeps the settings it supports on its own,
+ * in round r a radio is on the r-th setting of its list */
+static struct {
+    uint32_t supported[SWEEP_SETTINGS_MAX / 32];
+    uint16_t list[SWEEP_SETTINGS_MAX];  /* supported settings the plan selects */
+    uint16_t numof;         /* length of list */
+    uint16_t setting;       /* setting of the current round */
+    uint8_t applied_phy;    /* index into sweep_phys */
+    uint8_t applied_val[SWEEP_DIM_MAX]; /* option values the radio has */
+} sweep_plan[GNRC_NETIF_NUMOF];
+
+/* selected by the range_plan command */
+static range_plan_t plan_filter;
+/* indices into payloads[] of the selected payloads */
+static uint8_t plan_payload[ARRAY_SIZE(payloads)];
+static uint8_t plan_payload_numof;
+
+/* options pushed to the radios and options that were already set */
+static struct {
+    uint32_t sets;
+    uint32_t skipped;
+    uint32_t waits;         /* times a busy radio had to be waited for */
+    uint32_t timeouts;
+    uint32_t time_us;
+} reconf_stats;
+
+/* options that still have to be pushed to a radio */
+typedef struct {
+    netopt_t opt;
+    uint32_t data;
+    uint8_t data_len;
+    uint8_t dim;            /* index into applied_val, UINT8_MAX for the PHY */
+    uint8_t val;
+} reconf_op_t;
+
+static struct {
+    reconf_op_t op[1 + SWEEP_DIM_MAX];
+    uint8_t numof;
+    uint8_t done;
+} reconf_queue[GNRC_NETIF_NUMOF];
+
+/* a decoded setting index */
+typedef struct {
+    uint8_t phy;
+    uint8_t val[SWEEP_DIM_MAX];
+} sweep_pos_t;
+
+static void _sweep_decode(unsigned setting, sweep_pos_t *pos)
+{
+    unsigned i = ARRAY_SIZE(sweep_phys) - 1;
+
+    while (setting < sweep_layout[i].first) {
+        --i;
+    }
+
+    pos->phy = i;
+    setting -= sweep_layout[i].first;
+
+    for (unsigned d = 0; d < sweep_phys[i].dim_numof; ++d) {
+        pos->val[d] = setting / sweep_layout[i].stride[d];
+        setting    %= sweep_layout[i].stride[d];
+    }
+}
+
+/* find out which settings a radio accepts, the radio is left unconfigured */
+static void _sweep_probe(unsigned radio)
+{
+    kernel_pid_t pid = range_test_radio_pid() + radio;
+    int phy_ok = 0;
+
+    memset(&sweep_plan[radio], 0, sizeof(sweep_plan[radio]));
+    sweep_plan[radio].applied_phy = UINT8_MAX;
+    memset(sweep_plan[radio].applied_val, UINT8_MAX, SWEEP_DIM_MAX);
+
+    for (unsigned s = 0; s < sweep_combinations; ++s) {
+        sweep_pos_t pos;
+        _sweep_decode(s, &pos);
+
+        const sweep_phy_t *phy = &sweep_phys[pos.phy];
+
+        if (s == sweep_layout[pos.phy].first) {
+            uint32_t data = phy->phy;
+            phy_ok = _netapi_try_set(pid, NETOPT_IEEE802154_PHY, &data, 1) >= 0;
+        }
+
+        bool ok = phy_ok;
+        for (unsigned d = 0; d < phy->dim_numof && ok; ++d) {
+            const netopt_list_t *l = phy->dim[d];
+            ok = _netapi_try_set(pid, l->opt, &l->settings[pos.val[d]].data, l->data_len) >= 0;
+        }
+
+        if (ok) {
+            sweep_plan[radio].supported[s / 32] |= 1UL << (s % 32);
+            sweep_plan[radio].numof++;
+        }
+    }
+
+    printf("radio %u supports %u of %u settings\n",
+           radio, sweep_plan[radio].numof, sweep_combinations);
+}
+
+static bool _plan_selects(unsigned setting)
+{
+    sweep_pos_t pos;
+    _sweep_decode(setting, &pos);
+
+    for (unsigned d = 0; d < sweep_phys[pos.phy].dim_numof; ++d) {
+        if (!(plan_filter.values[pos.phy][d] & (1 << pos.val[d]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static unsigned _sweep_gray(unsigned n);
+
+/* build the list of every radio from the plan */
+static void _plan_update(void)
+{
+    plan_payload_numof = 0;
+    for (unsigned i = 0; i < ARRAY_SIZE(payloads); ++i) {
+        if (plan_filter.payloads & (1 << i)) {
+            plan_payload[plan_payload_numof++] = i;
+        }
+    }
+
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        sweep_plan[i].numof = 0;
+
+        for (unsigned n = 0; n < sweep_combinations; ++n) {
+            unsigned s = _sweep_gray(n);
+
+            if ((sweep_plan[i].supported[s / 32] & (1UL << (s % 32))) && _plan_selects(s)) {
+                sweep_plan[i].list[sweep_plan[i].numof++] = s;
+            }
+        }
+    }
+}
+
+static void _sweep_init(void)
+{
+    if (sweep_combinations) {
+        return;
+    }
+
+    for (unsigned i = 0; i < ARRAY_SIZE(sweep_phys); ++i) {
+        const sweep_phy_t *phy = &sweep_phys[i];
+        unsigned stride = 1;
+
+        for (unsigned d = phy->dim_numof; d > 0; --d) {
+            sweep_layout[i].stride[d - 1] = stride;
+            stride *= phy->dim[d - 1]->num_settings;
+        }
+
+        sweep_layout[i].first = sweep_combinations;
+        sweep_combinations += stride;
+    }
+
+    assert(sweep_combinations <= SWEEP_SETTINGS_MAX);
+    assert(ARRAY_SIZE(sweep_phys) <= RANGE_PLAN_PHY_MAX);
+    assert(ARRAY_SIZE(payloads) <= 16);
+
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        _sweep_probe(i);
+    }
+
+    /* sweep everything until told otherwise */
+    memset(&plan_filter, 0xff, sizeof(plan_filter));
+    _plan_update();
+}
+
+/* the schedule ends with the longest sweep of all radios */
+static unsigned _get_rounds(void)
+{
+    unsigned rounds = 0;
+
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        rounds = MAX(rounds, sweep_plan[i].numof);
+    }
+
+    return rounds;
+}
+
+static bool _radio_active(unsigned radio, unsigned round)
+{
+    return round < sweep_plan[radio].numof;
+}
+
+/* the settings of a PHY are visited in reflected mixed-radix Gray code
+ * order, so successive settings differ in a single option */
+static unsigned _sweep_gray(unsigned n)
+{
+    sweep_pos_t pos;
+    _sweep_decode(n, &pos);
+
+    const sweep_phy_t *phy = &sweep_phys[pos.phy];
+    unsigned setting = sweep_layout[pos.phy].first;
+    bool reflect = false;
+
+    for (unsigned d = 0; d < phy->dim_numof; ++d) {
+        unsigned v = pos.val[d];
+
+        if (reflect) {
+            v = phy->dim[d]->num_settings - 1 - v;
+        }
+        reflect ^= v & 1;
+
+        setting += v * sweep_layout[pos.phy].stride[d];
+    }
+
+    return setting;
+}
+
+/* setting of a radio in a round, the radio must be active in that round */
+static unsigned _plan_at(unsigned radio, unsigned round)
+{
+    return sweep_plan[radio].list[round];
+}
+
+static void _reconf_add(unsigned radio, netopt_t opt, uint32_t data, size_t data_len,
+                        unsigned dim, unsigned val)
+{
+    reconf_op_t *op = &reconf_queue[radio].op[reconf_queue[radio].numof++];
+
+    op->opt      = opt;
+    op->data     = data;
+    op->data_len = data_len;
+    op->dim      = dim;
+    op->val      = val;
+
+    reconf_stats.sets++;
+}
+
+static void _reconf_done(unsigned radio, const reconf_op_t *op, int res)
+{
+    if (res < 0) {
+        printf("[%d] failed setting %x to %x\n", range_test_radio_pid() + radio,
+               op->opt, (unsigned)op->data);
+
+        /* applies to all payload sizes of this setting */
+        setting_failed[radio] = true;
+        results[radio].invalid = true;
+    }
+
+    /* the radio might be left with anything */
+    if (op->dim == UINT8_MAX) {
+        if (res < 0) {
+            sweep_plan[radio].applied_phy = UINT8_MAX;
+        }
+    } else {
+        sweep_plan[radio].applied_val[op->dim] = res < 0 ? UINT8_MAX : op->val;
+    }
+}
+
+/* push the queued options to all radios at once, a busy radio is
+ * tried again when it reports the end of a transmission or reception */
+static void _reconf_run(void)
+{
+    mutex_t idle = MUTEX_INIT_LOCKED;
+    uint32_t start = xtimer_now();
+
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        results[i].reconf_us = 0;
+    }
+
+    while (1) {
+        unsigned pending = 0;
+
+        for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+            kernel_pid_t pid = range_test_radio_pid() + i;
+
+            while (reconf_queue[i].done < reconf_queue[i].numof) {
+                reconf_op_t *op = &reconf_queue[i].op[reconf_queue[i].done];
+
+                /* armed before the attempt, so the end of the TX can't be missed */
+                range_test_radio_idle_arm(pid, &idle);
+                int res = gnrc_netapi_set(pid, op->opt, 0, &op->data, op->data_len);
+                if (res == -EBUSY) {
+                    ++pending;
+                    break;
+                }
+
+                _reconf_done(i, op, res);
+
+                if (++reconf_queue[i].done == reconf_queue[i].numof) {
+                    range_test_radio_idle_arm(pid, NULL);
+                    results[i].reconf_us = xtimer_now() - start;
+                }
+            }
+        }
+
+        if (pending == 0) {
+            break;
+        }
+
+        uint32_t elapsed = xtimer_now() - start;
+        if (elapsed >= RECONF_TIMEOUT_US) {
+            break;
+        }
+
+        reconf_stats.waits++;
+        xtimer_mutex_lock_timeout(&idle, MIN(RECONF_TIMEOUT_US - elapsed, RECONF_RECHECK_US));
+    }
+
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        if (reconf_queue[i].done < reconf_queue[i].numof) {
+            printf("[%d] radio stayed busy\n", range_test_radio_pid() + i);
+            range_test_radio_idle_arm(range_test_radio_pid() + i, NULL);
+            results[i].reconf_us = xtimer_now() - start;
+            reconf_stats.timeouts++;
+
+            /* the options that are left keep their old value */
+            _reconf_done(i, &reconf_queue[i].op[reconf_queue[i].done], -ETIMEDOUT);
+        }
+
+        reconf_stats.time_us += results[i].reconf_us;
+        reconf_queue[i].numof = 0;
+        reconf_queue[i].done  = 0;
+    }
+}
+
+static void _set(unsigned radio, unsigned idx, bool do_set)
+{
+    sweep_pos_t pos;
+    _sweep_decode(idx, &pos);
+
+    const sweep_phy_t *phy = &sweep_phys[pos.phy];
+
+    printf("%s ", phy->name);
+    for (unsigned d = 0; d < phy->dim_numof; ++d) {
+        if (d) {
+            printf(", ");
+        }
+
+        _set_from_netopt_list(phy->dim[d], pos.val[d]);
+
+        if (!do_set) {
+            continue;
+        }
+
+        /* only push options that differ from what the radio already has */
+        if (sweep_plan[radio].applied_val[d] == pos.val[d]) {
+            reconf_stats.skipped++;
+            continue;
+        }
+
+        _reconf_add(radio, phy->dim[d]->opt, phy->dim[d]->settings[pos.val[d]].data,
+                    phy->dim[d]->data_len, d, pos.val[d]);
+    }
+}
+
+static int _print(char *str, size_t len, unsigned idx)
+{
+    sweep_pos_t pos;
+    _sweep_decode(idx, &pos);
+
+    const sweep_phy_t *phy = &sweep_phys[pos.phy];
+    int res, total = 0;
+
+    res = snprintf(str, len, "%s ", phy->name);
+    total += _advance_str(&str, &len, res);
+
+    for (unsigned d = 0; d < phy->dim_numof && len > 1; ++d) {
+        if (d) {
+            res = snprintf(str, len, ", ");
+            total += _advance_str(&str, &len, res);
+        }
+        res = _print_from_netopt_list(str, len, phy->dim[d], pos.val[d]);
+        total += _advance_str(&str, &len, res);
+    }
+
+    return total;
+}
+
+static void _sweep_phy_cfg(unsigned setting, phy_cfg_t *cfg)
+{
+    sweep_pos_t pos;
+    _sweep_decode(setting, &pos);
+
+    const sweep_phy_t *phy = &sweep_phys[pos.phy];
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->phy = phy->phy;
+
+    for (unsigned d = 0; d < phy->dim_numof; ++d) {
+        uint32_t data = phy->dim[d]->settings[pos.val[d]].data;
+
+        switch (phy->dim[d]->opt) {
+        case NETOPT_MR_OFDM_OPTION:
+            cfg->ofdm_option = data;
+            break;
+        case NETOPT_MR_OFDM_MCS:
+            cfg->ofdm_mcs = data;
+            break;
+        case NETOPT_MR_OQPSK_RATE:
+        case NETOPT_OQPSK_RATE:
+            cfg->oqpsk_rate = data;
+            break;
+        case NETOPT_MR_OQPSK_CHIPS:
+            cfg->oqpsk_chips = data;
+            break;
+        case NETOPT_MR_FSK_SRATE:
+            cfg->fsk_srate = data;
+            break;
+        case NETOPT_MR_FSK_MODULATION_ORDER:
+            cfg->fsk_mord = data;
+            break;
+        case NETOPT_MR_FSK_FEC:
+            cfg->fsk_fec = data;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* bytes sent for payloads[p] */
+static uint16_t _payload_len(unsigned p)
+{
+    return MAX(payloads[p], payload_min);
+}
+
+void range_test_set_payload_min(uint16_t len)
+{
+    payload_min = len;
+}
+
+/* expected airtime of a ping, step is setting * payloads + payload */
+static uint32_t _model_airtime(unsigned step)
+{
+    phy_cfg_t cfg;
+    unsigned frames;
+
+    _sweep_phy_cfg(step / ARRAY_SIZE(payloads), &cfg);
+    return range_test_airtime_packet(&cfg, _payload_len(step % ARRAY_SIZE(payloads)),
+                                     range_test_raw_mode(), &frames);
+}
+
+/* index into payloads[] of the current step */
+static unsigned _payload(void)
+{
+    return plan_payload[_payload_idx];
+}
+
+/* step is round * selected payloads + payload */
+static uint32_t _dwell_ms(unsigned step)
+{
+    uint32_t period = range_test_period_ms();
+    unsigned round = step / plan_payload_numof;
+    unsigned payload = plan_payload[step % plan_payload_numof];
+
+    if (!adaptive_dwell || round >= _get_rounds()) {
+        return period;
+    }
+
+    /* the round lasts as long as the slowest of its settings needs */
+    uint32_t airtime = 0;
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        if (_radio_active(i, round)) {
+            unsigned setting = _plan_at(i, round);
+            airtime = MAX(airtime, _model_airtime(setting * ARRAY_SIZE(payloads) + payload));
+        }
+    }
+
+    uint32_t rtt = 2 * airtime + TURNAROUND_US;
+    uint32_t dwell = (DWELL_PINGS * (uint64_t)rtt) / US_PER_MS;
+
+    return MAX(DWELL_MIN_MS, MIN(dwell, period));
+}
+
+/* how long to wait for the answer to a control message on the current setting */
+uint32_t range_test_control_timeout(unsigned len)
+{
+    uint32_t airtime = 0;
+
+    /* control messages go out on all radios */
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        phy_cfg_t cfg;
+        unsigned frames;
+
+        /* a radio that is done with its sweep sends no more */
+        if (!_radio_active(i, idx)) {
+            continue;
+        }
+
+        _sweep_phy_cfg(sweep_plan[i].setting, &cfg);
+        airtime = MAX(airtime, range_test_airtime_packet(&cfg, len, range_test_raw_mode(),
+                                                         &frames));
+    }
+
+    return MIN(2 * airtime + TURNAROUND_US, max_delay_ms[0] * US_PER_MS);
+}
+
+uint32_t range_test_dwell_ms(unsigned ahead)
+{
+    return _dwell_ms(idx * plan_payload_numof + _payload_idx + ahead);
+}
+
+void range_test_set_adaptive_dwell(bool on)
+{
+    adaptive_dwell = on;
+}
 
 #ifdef MODULE_VFS_DEFAULT
-#include <fcntl.h>
-#include "vfs_default.h"
+/* the header must be complete, a log without it can't be decoded */
+static int _log_hdr(const void *data, size_t len)
+{
+    return range_test_store_write_all(data, len);
+}
+
+static int _log_str(const char *str)
+{
+    uint8_t len = strlen(str);
+
+    return _log_hdr(&len, sizeof(len)) | _log_hdr(str, len);
+}
 
-#ifndef DATA_DIR
-#define DATA_DIR VFS_DEFAULT_DATA "/range"
+/* describe the sweep so the log can be decoded without this firmware */
+static void file_store_open(void)
+{
+    unsigned num = range_test_store_next();
+    range_log_hdr_t hdr = {
+        .magic = RANGE_LOG_MAGIC,
+        .version = RANGE_LOG_VERSION,
+        .rec_size = sizeof(range_log_rec_t),
+        .phy_numof = ARRAY_SIZE(sweep_phys),
+        .payload_numof = ARRAY_SIZE(payloads),
+    };
+
+    int res;
+
+    range_test_store_open(num);
+    res  = _log_hdr(&hdr, sizeof(hdr));
+    res |= _log_hdr(payloads, sizeof(payloads));
+
+    for (unsigned i = 0; i < ARRAY_SIZE(sweep_phys); ++i) {
+        const sweep_phy_t *phy = &sweep_phys[i];
+
+        res |= _log_hdr(&phy->phy, sizeof(phy->phy));
+        res |= _log_hdr(&phy->dim_numof, sizeof(phy->dim_numof));
+        res |= _log_str(phy->name);
+
+        for (unsigned d = 0; d < phy->dim_numof; ++d) {
+            const netopt_list_t *l = phy->dim[d];
+
+            res |= _log_str(l->name);
+            res |= _log_hdr(&l->num_settings, sizeof(l->num_settings));
+            for (unsigned v = 0; v < l->num_settings; ++v) {
+                res |= _log_str(l->settings[v].name);
+            }
+        }
+    }
+
+    if (res) {
+        printf("can't write the header of log %u, the results are not logged\n", num);
+        range_test_store_close();
+    }
+}
+
+static int file_store_resume(void)
+{
+    return range_test_store_resume();
+}
+
+static void file_store_close(void)
+{
+    range_test_store_close();
+}
+
+static uint16_t _log_time(uint32_t us, unsigned unit)
+{
+    return MIN(us / unit, UINT16_MAX);
+}
+
+static void _log_link(range_log_link_t *dst, const link_stat_t *src)
+{
+    dst->mean = src->mean;
+    dst->sdev = src->sdev;
+    dst->min  = src->min;
+    dst->max  = src->max;
+}
+
+static void file_store_add(unsigned iface, unsigned step, const test_result_t *result)
+{
+    if (result->invalid) {
+        return;
+    }
+
+    range_log_rec_t rec = {
+        .step = step,
+        .iface = iface,
+        .frames = result->frames,
+        .payload_size = result->payload_size,
+        .sent = result->pkts_send,
+        .received = result->pkts_rcvd,
+        .rtt_last = _log_time(result->rtt_ticks, RANGE_LOG_RTT_US),
+        .rtt_mean = _log_time(result->rtt.mean, RANGE_LOG_RTT_US),
+        .rtt_sdev = _log_time(result->rtt.sdev, RANGE_LOG_RTT_US),
+        .rtt_min = _log_time(result->rtt.min, RANGE_LOG_RTT_US),
+        .rtt_max = _log_time(result->rtt.max, RANGE_LOG_RTT_US),
+        .airtime = _log_time(result->airtime, RANGE_LOG_AIRTIME_US),
+        .reconf = _log_time(result->reconf_us, RANGE_LOG_RTT_US),
+        .goodput = result->goodput,
+        .fwd_received = result->fwd_rcvd,
+        .dups = result->dups,
+        .reordered = result->reordered,
+        .uplink = _log_time(result->uplink_us, RANGE_LOG_RTT_US),
+        .turnaround = _log_time(result->turnaround_us, RANGE_LOG_RTT_US),
+        .downlink = _log_time(result->downlink_us, RANGE_LOG_RTT_US),
+        .radio = _log_time(result->radio_us, RANGE_LOG_RTT_US),
+        .stack = _log_time(result->stack_us, RANGE_LOG_RTT_US),
+        .flags = result->rx_samples ? 0 : RANGE_LOG_FLAG_NO_RX,
+    };
+
+    for (unsigned i = 0; i < 2; ++i) {
+        _log_link(&rec.rssi[i], &result->rssi[i]);
+        _log_link(&rec.lqi[i], &result->lqi[i]);
+    }
+
+    for (unsigned p = 0; p < RTT_PERCENTILES_NUMOF; ++p) {
+        /* RANGE_LOG_FLAG_NO_RX is set without an RTT */
+        if (result->rtt_pct[p] != RTT_PCT_NONE) {
+            rec.rtt_pct[p] = _log_time(_hist_bucket_max(result->rtt_pct[p]), RANGE_LOG_RTT_US);
+        }
+    }
+
+    range_test_store_write(&rec, sizeof(rec));
+}
+#else
+static inline void file_store_open(void) {}
+static inline int file_store_resume(void) { return -ENOTSUP; }
+static inline void file_store_close(void) {}
+static inline void file_store_add(unsigned iface, unsigned step,
+                                  const test_result_t *result)
+{
+    (void)iface;
+    (void)step;
+    (void)result;
+}
 #endif
 
-static int _result_fd;
+static void _apply_setting(unsigned radio, unsigned setting)
+{
+    printf("[%d] %u: Set ", idx, radio);
+
+    /* switch the PHY when entering a setting of another PHY */
+    sweep_pos_t pos;
+    _sweep_decode(setting, &pos);
+    if (pos.phy != sweep_plan[radio].applied_phy) {
+        _reconf_add(radio, NETOPT_IEEE802154_PHY, sweep_phys[pos.phy].phy, 1,
+                    UINT8_MAX, pos.phy);
+        sweep_plan[radio].applied_phy = pos.phy;
+
+        /* the options of the new PHY are unknown */
+        memset(sweep_plan[radio].applied_val, UINT8_MAX, SWEEP_DIM_MAX);
+    }
+
+    _set(radio, setting, true);
+
+    puts("");
+}
+
+static void _set_modulation(unsigned round)
+{
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        setting_failed[i] = false;
+        results[i].invalid = false;
+
+        /* the radio is done with its sweep, it stays idle */
+        if (!_radio_active(i, round)) {
+            setting_failed[i] = true;
+            results[i].invalid = true;
+            continue;
+        }
+
+        sweep_plan[i].setting = _plan_at(i, round);
+        _apply_setting(i, sweep_plan[i].setting);
+    }
+
+    _reconf_run();
+    reapply = false;
+}
+
+void range_test_begin_measurement(kernel_pid_t netif)
+{
+    netif -= range_test_radio_pid();
+
+    if (results[netif].pkts_send < UINT16_MAX) {
+        results[netif].pkts_send++;
+    }
+    /* also for streams and settings without a reply */
+    results[netif].payload_size = range_test_payload_size();
+    if (results[netif].rtt_ticks == 0) {
+        results[netif].rtt_ticks = max_delay_ms[_payload()] * US_PER_MS;
+    }
+}
+
+/* pings whose outcome was never seen are not part of the result */
+void range_test_cancel_measurement(kernel_pid_t netif, unsigned pings)
+{
+    netif -= range_test_radio_pid();
+
+    results[netif].pkts_send -= MIN(pings, results[netif].pkts_send);
+}
+
+uint32_t range_test_get_timeout(kernel_pid_t netif)
+{
+    netif -= range_test_radio_pid();
+
+    unsigned _idx = sweep_plan[netif].setting * ARRAY_SIZE(payloads) + _payload();
+    test_result_t *res = &results[netif];
+    uint32_t rto_max = max_delay_ms[_payload()] * US_PER_MS;
+    uint32_t rto;
+
+    if (res->srtt) {
+        rto = res->srtt + MAX(RTO_MIN_US, 4 * res->rttvar);
+    } else if (res->frames) {
+        /* ping and pong are on air for the same time */
+        rto = 2 * res->airtime + TURNAROUND_US;
+    } else {
+        rto = 2 * _model_airtime(_idx) + TURNAROUND_US;
+    }
+
+    /* back off, but never wait longer than for the slowest modulation */
+    return MIN(rto << res->backoff, rto_max);
+}
+
+/* smoothed RTT and RTT variance as in RFC 6298 */
+static void _rto_update(test_result_t *res, uint32_t rtt)
+{
+    if (res->srtt == 0) {
+        res->srtt   = rtt;
+        res->rttvar = rtt / 2;
+    } else {
+        uint32_t delta = rtt > res->srtt ? rtt - res->srtt : res->srtt - rtt;
+        res->rttvar = res->rttvar - res->rttvar / 4 + delta / 4;
+        res->srtt   = res->srtt - res->srtt / 8 + rtt / 8;
+    }
+
+    res->backoff = 0;
+}
+
+void range_test_set_airtime(kernel_pid_t netif, uint32_t airtime, unsigned frames)
+{
+    netif -= range_test_radio_pid();
+
+    if (frames) {
+        results[netif].airtime = airtime;
+        results[netif].frames  = frames;
+    }
+}
 
-static ssize_t vfs_write_string(int fd, const char *src)
+void range_test_invalidate(kernel_pid_t netif)
 {
-    return vfs_write(fd, src, strlen(src));
+    netif -= range_test_radio_pid();
+
+    results[netif].invalid = true;
 }
 
-static void file_store_open(unsigned num)
+/* what the responder received of the streamed frames */
+void range_test_add_stream(kernel_pid_t netif, unsigned rcvd, uint32_t bytes, uint32_t span_us)
 {
-    char buffer[48];
+    netif -= range_test_radio_pid();
 
-    if (_result_fd != 0) {
-        vfs_close(_result_fd);
-    }
+    test_result_t *res = &results[netif];
 
-    vfs_mkdir(DATA_DIR, 0777);
-    snprintf(buffer, sizeof(buffer), DATA_DIR "/%u.csv", num);
+    res->pkts_rcvd = MIN(rcvd, res->pkts_send);
+    res->pkts_lost = res->pkts_send - res->pkts_rcvd;
+    res->goodput   = span_us ? ((uint64_t)bytes * US_PER_SEC) / span_us : 0;
+}
 
-    _result_fd = vfs_open(buffer, O_CREAT | O_WRONLY, 0644);
-    if (_result_fd < 0) {
-        printf("can't create file: %d\n", _result_fd);
-        return;
-    }
+/* RTT of the last measurement split at the responder's timestamps */
+void range_test_add_oneway(kernel_pid_t netif, uint32_t uplink,
+                           uint32_t turnaround, uint32_t downlink)
+{
+    netif -= range_test_radio_pid();
+
+    bool first = results[netif].rx_samples == 1;
+    stat_acc_t *stats = rx_stats[netif];
 
-    vfs_write_string(_result_fd,
-                     "modulation;iface;payload;sent;received;RSSI_local;RSSI_remote;RTT\n");
+    _stat_add(&stats[STAT_UPLINK], uplink, first);
+    _stat_add(&stats[STAT_TURNAROUND], turnaround, first);
+    _stat_add(&stats[STAT_DOWNLINK], downlink, first);
 }
 
-static void file_store_close(void)
+/* RTT of the last measurement split into radio and software time.
+ * The RX stamp is taken as the pong's if no other frame is queued behind
+ * it, a frame received in between can still move it, so the split is an
+ * estimate and left out for pongs where that check fails. */
+void range_test_add_radio_time(kernel_pid_t netif, uint32_t radio, uint32_t stack)
 {
-    if (_result_fd <= 0) {
-        return;
-    }
+    netif -= range_test_radio_pid();
 
-    vfs_close(_result_fd);
-    _result_fd = 0;
+    bool first = ++results[netif].radio_samples == 1;
+    stat_acc_t *stats = rx_stats[netif];
+
+    _stat_add(&stats[STAT_RADIO], radio, first);
+    _stat_add(&stats[STAT_STACK], stack, first);
 }
 
-static void file_store_add(unsigned iface, test_result_t *result)
+/* what the responder echoed of the pings it received, the counters
+ * only grow during a step so pongs may arrive in any order */
+void range_test_add_forward(kernel_pid_t netif, unsigned rcvd,
+                            unsigned dups, unsigned reordered)
 {
-    static char line[128];
-
-    if (_result_fd <= 0) {
-        return;
-    }
+    netif -= range_test_radio_pid();
 
-    if (result->invalid) {
+    /* a pong may come in on an interface that isn't tested */
+    if ((unsigned)netif >= range_test_radio_numof()) {
         return;
     }
 
-    line[0] = '"';
-    int res = _print(&line[1], sizeof(line) - 1, idx) + 1;
+    test_result_t *res = &results[netif];
 
-    snprintf(&line[res], sizeof(line) - res, "\";%u;%u;%u;%u;%d;%d;%u\n",
-             iface,
-             result->payload_size,
-             result->pkts_send,
-             result->pkts_rcvd,
-             (int)(result->rssi_sum[0] / result->pkts_rcvd),
-             (int)(result->rssi_sum[1] / result->pkts_rcvd),
-             (unsigned)result->rtt_ticks);
-    vfs_write_string(_result_fd, line);
+    res->fwd_rcvd  = MAX(res->fwd_rcvd, rcvd);
+    res->dups      = MAX(res->dups, dups);
+    res->reordered = MAX(res->reordered, reordered);
 }
-#else
-static inline void file_store_open(unsigned num) { (void)num; }
-static inline void file_store_close(void) {}
-static inline void file_store_add(unsigned iface, test_result_t *result)
+
+void range_test_add_timeout(kernel_pid_t netif, unsigned lost)
 {
-    (void)iface;
-    (void)result;
+    netif -= range_test_radio_pid();
+
+    results[netif].pkts_lost += lost;
+
+    if (results[netif].backoff < BACKOFF_MAX) {
+        results[netif].backoff++;
+    }
 }
-#endif
 
-static void _netapi_set_forall(netopt_t opt, const void *data, size_t data_len)
+void range_test_add_late(kernel_pid_t netif)
 {
-    unsigned i = 0;
-    for (unsigned pid = range_test_radio_pid(); i < range_test_radio_numof(); ++pid) {
-        int res;
-        while ((res = gnrc_netapi_set(pid, opt, 0, data, data_len)) == -EBUSY) {
-            /* at86rf215 driver needs some time in busy state */
-            xtimer_msleep(1);
-        }
-        if (res < 0) {
-            printf("[%d] failed setting %x to %x\n", pid, opt, *(uint8_t*) data);
+    netif -= range_test_radio_pid();
 
-            if (results[i]) {
-                for (unsigned j = 0; j < ARRAY_SIZE(payloads); ++j) {
-                    results[i][idx + j].invalid = true;
-                }
-            }
-        }
-        ++i;
+    if ((unsigned)netif >= range_test_radio_numof()) {
+        return;
+    }
+
+    if (results[netif].pkts_late < UINT16_MAX) {
+        results[netif].pkts_late++;
     }
 }
 
-static void _set_from_netopt_list(const netopt_list_t *l, unsigned idx, bool do_set) {
-    printf("%s = %s", l->name, l->settings[idx].name);
+void range_test_add_measurement(kernel_pid_t netif, uint32_t ticks,
+                                int rssi_local, int rssi_remote,
+                                unsigned lqi_local, unsigned lqi_remote,
+                                uint16_t payload_size)
+{
+    netif -= range_test_radio_pid();
 
-    if (do_set) {
-        _netapi_set_forall(l->opt, &l->settings[idx].data, l->data_len);
+    /* saturate like pkts_send, received must not wrap past sent */
+    bool first = results[netif].rx_samples == 0;
+    if (results[netif].pkts_rcvd < UINT16_MAX) {
+        results[netif].pkts_rcvd++;
+    }
+    if (results[netif].rx_samples < UINT16_MAX) {
+        results[netif].rx_samples++;
     }
+    stat_acc_t *stats = rx_stats[netif];
+
+    _stat_add(&stats[STAT_RSSI_LOCAL], rssi_local, first);
+    _stat_add(&stats[STAT_RSSI_REMOTE], rssi_remote, first);
+    _stat_add(&stats[STAT_LQI_LOCAL], lqi_local, first);
+    _stat_add(&stats[STAT_LQI_REMOTE], lqi_remote, first);
+    _stat_add(&stats[STAT_RTT], ticks, first);
+
+    results[netif].rtt_ticks = ticks;
+    results[netif].payload_size = payload_size;
+    _rto_update(&results[netif], ticks);
+    _hist_add(rtt_hist[netif], ticks);
 }
 
-static int _print_from_netopt_list(char *str, size_t size, const netopt_list_t *l, unsigned idx)
+static void _print_header(void)
 {
-    return snprintf(str, size, "%s = %s", l->name, l->settings[idx].name);
+    printf("modulation;iface;payload;sent;received;LQI_local;LQI_remote;RSSI_local;RSSI_remote;RTT;"
+           "RTT_p50;RTT_p90;RTT_p99;airtime;frames;RSSI_local_sd;RSSI_remote_sd;"
+           "RTT_mean;RTT_sd;RTT_min;RTT_max;reconf;goodput;fwd_received;dups;reordered;"
+           "uplink;turnaround;downlink;RTT_radio;RTT_stack\n");
 }
 
-static int _advance_str(char **str, size_t *len, int res)
+static void _print_empty(unsigned fields)
 {
-    *str += res;
-    *len -= res;
-    return res;
+    while (fields--) {
+        printf(";");
+    }
 }
 
-#ifdef TEST_OFDM
-static unsigned _get_OFDM_combinations(void)
+static void _print_result(unsigned iface, unsigned step, const test_result_t *result)
 {
-    static unsigned combinations;
+    uint32_t ticks = result->rtt_ticks;
 
-    if (combinations == 0) {
-        combinations = ofdm_options.num_settings * ofdm_mcs.num_settings;
-    }
+    /* streamed frames aren't answered, so there is no RSSI, LQI or RTT */
+    bool rx = result->rx_samples > 0;
 
-    return combinations;
-}
+    printf("\"");
+    _set(iface, step / ARRAY_SIZE(payloads), false);
+    printf("\";");
 
-static int _set_OFDM(unsigned setting, bool do_set)
-{
-    for (unsigned i = 0; i < ofdm_options.num_settings; ++i) {
-        for (unsigned j = 0; j < ofdm_mcs.num_settings; ++j) {
-            if (setting-- == 0) {
-                printf("OFDM ");
-                _set_from_netopt_list(&ofdm_options, i, do_set);
-                printf(", ");
-                _set_from_netopt_list(&ofdm_mcs, j, do_set);
-                return 0;
-            }
-        }
+    if (result->invalid) {
+        puts(" INVALID");
+        return;
     }
 
-    return -1;
-}
-
-static int _print_OFDM(char *str, size_t len, unsigned setting)
-{
-    for (unsigned i = 0; i < ofdm_options.num_settings; ++i) {
-        for (unsigned j = 0; j < ofdm_mcs.num_settings; ++j) {
-            if (setting-- == 0) {
-                int res, total = 0;
-                res = snprintf(str, len, "OFDM ");
-                total += _advance_str(&str, &len, res);
-                res = _print_from_netopt_list(str, len, &ofdm_options, i);
-                total += _advance_str(&str, &len, res);
-                res = snprintf(str, len, ", ");
-                total += _advance_str(&str, &len, res);
-                res = _print_from_netopt_list(str, len, &ofdm_mcs, j);
-                total += _advance_str(&str, &len, res);
-                return total;
+    printf("%d;", iface);
+    printf("%d;", result->payload_size);
+    printf("%d;", result->pkts_send);
+    printf("%d;", result->pkts_rcvd);
+    if (rx) {
+        printf(TENTHS_FMT ";", TENTHS(result->lqi[0].mean));
+        printf(TENTHS_FMT ";", TENTHS(result->lqi[1].mean));
+        printf(TENTHS_FMT ";", TENTHS(result->rssi[0].mean));
+        printf(TENTHS_FMT ";", TENTHS(result->rssi[1].mean));
+        printf("%ld;", xtimer_usec_from_ticks(ticks));
+        for (unsigned p = 0; p < RTT_PERCENTILES_NUMOF; ++p) {
+            if (result->rtt_pct[p] == RTT_PCT_NONE) {
+                _print_empty(1);
+            } else {
+                printf("%lu;", (unsigned long)_hist_bucket_max(result->rtt_pct[p]));
             }
         }
+    } else {
+        _print_empty(5 + RTT_PERCENTILES_NUMOF);
     }
-
-    return 0;
+    printf("%lu;", (unsigned long)result->airtime);
+    printf("%u;", result->frames);
+    if (rx) {
+        printf("%u.%u;", result->rssi[0].sdev / 10, result->rssi[0].sdev % 10);
+        printf("%u.%u;", result->rssi[1].sdev / 10, result->rssi[1].sdev % 10);
+        printf("%lu;%lu;%lu;%lu;",
+               (unsigned long)result->rtt.mean,
+               (unsigned long)result->rtt.sdev,
+               (unsigned long)result->rtt.min,
+               (unsigned long)result->rtt.max);
+    } else {
+        _print_empty(6);
+    }
+    printf("%lu;%lu",
+           (unsigned long)result->reconf_us,
+           (unsigned long)result->goodput);
+    printf(";%u;%u;%u", result->fwd_rcvd, result->dups, result->reordered);
+    printf(";%lu;%lu;%lu",
+           (unsigned long)result->uplink_us,
+           (unsigned long)result->turnaround_us,
+           (unsigned long)result->downlink_us);
+    printf(";%lu;%lu",
+           (unsigned long)result->radio_us,
+           (unsigned long)result->stack_us);
+
+    if (result->goodput) {
+        printf("\t|\t%d %%", (100 * result->pkts_rcvd) / result->pkts_send);
+        printf(" goodput = %lu byte/s", (unsigned long)result->goodput);
+    } else if (result->pkts_send && ticks) {
+        printf("\t|\t%d %%", (100 * result->pkts_rcvd) / result->pkts_send);
+        printf(" max = %lu byte/s", (result->payload_size * US_PER_SEC) / ticks);
+        printf(" avg = %lu byte/s",
+               (unsigned long)(((uint64_t)result->pkts_rcvd * result->payload_size * 1000) /
+                               MAX(result->dwell_ms, 1)));
+    }
+    if (result->fwd_rcvd && !result->goodput) {
+        /* a pong is only sent for a ping that arrived */
+        /* pings cancelled at a switch may still have arrived */
+        printf(" fwd = %d %%", (100 * MIN(result->fwd_rcvd, result->pkts_send)) /
+                               MAX(result->pkts_send, 1));
+        /* a late pong still made it back */
+        unsigned rev = result->pkts_rcvd + result->pkts_late;
+        printf(" rev = %d %%", (100 * MIN(rev, result->fwd_rcvd)) / result->fwd_rcvd);
+    }
+    puts("");
 }
-#else
-static unsigned _get_OFDM_combinations(void)
+
+uint16_t range_test_payload_size(void)
 {
-    return 0;
+    return _payload_len(_payload());
 }
 
-static int _print_OFDM(char *str, size_t len, unsigned setting)
+unsigned range_test_step(void)
 {
-    (void)str;
-    (void)len;
-    (void)setting;
+    return idx * plan_payload_numof + _payload_idx;
+}
 
-    return 0;
+/* the next step is the first one of a new setting */
+bool range_test_setting_boundary(void)
+{
+    return _payload_idx == 0;
 }
 
-static int _set_OFDM(unsigned setting, bool do_set)
+unsigned range_test_step_numof(void)
 {
-    (void) setting;
-    (void) do_set;
+    return _get_rounds() * plan_payload_numof;
+}
 
-    return -1;
+bool range_test_radio_active(kernel_pid_t netif)
+{
+    return _radio_active(netif - range_test_radio_pid(), idx);
 }
-#endif  /* OFDM */
 
-#ifdef TEST_OQPSK
-static unsigned _get_OQPSK_combinations(void)
+/* jump to a step, used by the responder to follow the coordinator */
+void range_test_goto(unsigned step)
 {
-    static unsigned combinations;
+    if (step >= range_test_step_numof()) {
+        return;
+    }
 
-    if (combinations == 0) {
-        combinations = oqpsk_rates.num_settings * oqpsk_chips.num_settings;
+    if (step / plan_payload_numof != idx || reapply) {
+        idx = step / plan_payload_numof;
+        _set_modulation(idx);
     }
 
-    return combinations;
+    _payload_idx = step % plan_payload_numof;
 }
 
-static int _set_OQPSK(unsigned setting, bool do_set)
+/* the first setting of each radio's sweep is where both sides meet if
+ * they lost each other, the position in the sweep is kept */
+void range_test_rendezvous(void)
 {
-    for (unsigned i = 0; i < oqpsk_rates.num_settings; ++i) {
-        for (unsigned j = 0; j < oqpsk_chips.num_settings; ++j) {
-            if (setting-- == 0) {
-                printf("O-QPSK ");
-                _set_from_netopt_list(&oqpsk_rates, i, do_set);
-                printf(", ");
-                _set_from_netopt_list(&oqpsk_chips, j, do_set);
-                return 0;
-            }
+    printf("rendezvous: ");
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        if (sweep_plan[i].numof) {
+            _apply_setting(i, _plan_at(i, 0));
         }
     }
-
-    return -1;
+    _reconf_run();
+    reapply = true;
 }
 
-static int _print_OQPSK(char *str, size_t len, unsigned setting)
-{
-    for (unsigned i = 0; i < oqpsk_rates.num_settings; ++i) {
-        for (unsigned j = 0; j < oqpsk_chips.num_settings; ++j) {
-            if (setting-- == 0) {
-                int res, total = 0;
-                res = snprintf(str, len, "O-QPSK ");
-                total += _advance_str(&str, &len, res);
-                res = _print_from_netopt_list(str, len, &oqpsk_rates, i);
-                total += _advance_str(&str, &len, res);
-                res = snprintf(str, len, ", ");
-                total += _advance_str(&str, &len, res);
-                res = _print_from_netopt_list(str, len, &oqpsk_chips, j);
-                total += _advance_str(&str, &len, res);
-                return total;
-            }
-        }
-    }
-
-    return 0;
-}
-#else
-static unsigned _get_OQPSK_combinations(void)
+/* time on all settings, switching and early termination are not included */
+static uint64_t _plan_duration_ms(void)
 {
-    return 0;
-}
+    uint64_t total = 0;
 
-static int _print_OQPSK(char *str, size_t len, unsigned setting)
-{
-    (void)str;
-    (void)len;
-    (void)setting;
+    for (unsigned step = 0; step < range_test_step_numof(); ++step) {
+        total += _dwell_ms(step);
+    }
 
-    return 0;
+    return total;
 }
 
-static int _set_OQPSK(unsigned setting, bool do_set)
+static bool _plan_phy_selected(const range_plan_t *plan, unsigned phy)
 {
-    (void) setting;
-    (void) do_set;
+    for (unsigned d = 0; d < sweep_phys[phy].dim_numof; ++d) {
+        unsigned all = (1 << sweep_phys[phy].dim[d]->num_settings) - 1;
+        if ((plan->values[phy][d] & all) == 0) {
+            return false;
+        }
+    }
 
-    return -1;
+    return true;
 }
-#endif  /* O-QPSK */
 
-#ifdef TEST_LEGCAY_OQPSK
-static unsigned _get_legacy_OQPSK_combinations(void)
+static void _plan_print(void)
 {
-    return legacy_oqpsk_rates.num_settings;
-}
+    for (unsigned p = 0; p < ARRAY_SIZE(sweep_phys); ++p) {
+        const sweep_phy_t *phy = &sweep_phys[p];
 
-static int _set_legacy_OQPSK(unsigned setting, bool do_set)
-{
-    for (unsigned i = 0; i < legacy_oqpsk_rates.num_settings; ++i) {
-        if (setting-- == 0) {
-            printf("O-QPSK ");
-            _set_from_netopt_list(&legacy_oqpsk_rates, i, do_set);
-            return 0;
+        if (!_plan_phy_selected(&plan_filter, p)) {
+            continue;
         }
-    }
 
-    return -1;
-}
+        printf("%s", phy->name);
+        for (unsigned d = 0; d < phy->dim_numof; ++d) {
+            const netopt_list_t *l = phy->dim[d];
+            const char *sep = "";
 
-static int _print_legacy_OQPSK(char *str, size_t len, unsigned setting)
-{
-    for (unsigned i = 0; i < legacy_oqpsk_rates.num_settings; ++i) {
-        if (setting-- == 0) {
-                int res, total = 0;
-                res = snprintf(str, len, "O-QPSK ");
-                total += _advance_str(&str, &len, res);
-                res = _print_from_netopt_list(str, len, &legacy_oqpsk_rates, i);
-                total += _advance_str(&str, &len, res);
-                return total;
+            printf(" %s=", l->name);
+            for (unsigned v = 0; v < l->num_settings; ++v) {
+                if (plan_filter.values[p][d] & (1 << v)) {
+                    printf("%s'%s'", sep, l->settings[v].name);
+                    sep = ",";
+                }
+            }
         }
+        puts("");
     }
 
-    return 0;
-}
+    printf("payload=");
+    for (unsigned i = 0; i < plan_payload_numof; ++i) {
+        printf("%s%u", i ? "," : "", payloads[plan_payload[i]]);
+    }
+    puts("");
 
-#else
-static int _print_legacy_OQPSK(char *str, size_t len, unsigned setting)
-{
-    (void)str;
-    (void)len;
-    (void)setting;
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        printf("radio %u: %u settings\n", i, sweep_plan[i].numof);
+    }
 
-    return 0;
+    printf("%u steps, at most %lu s with the current period\n", range_test_step_numof(),
+           (unsigned long)(_plan_duration_ms() / MS_PER_SEC));
 }
 
-static unsigned _get_legacy_OQPSK_combinations(void)
+void range_test_plan_get(range_plan_t *plan)
 {
-    return 0;
+    *plan = plan_filter;
 }
 
-static int _set_legacy_OQPSK(unsigned setting, bool do_set)
+/* the radios keep their setting, they are configured on the next switch */
+void range_test_plan_set(const range_plan_t *plan)
 {
-    (void) setting;
-    (void) do_set;
-
-    return -1;
+    plan_filter = *plan;
+    _plan_update();
+    reapply = true;
 }
-#endif  /* legacy O-QPSK */
 
-#ifdef TEST_FSK
-static unsigned _get_FSK_combinations(void)
+/* bit mask of the values of a list that match 'op value[,value…]',
+ * values are given by name or by their data */
+static uint16_t _plan_match(const char *op, const char *arg,
+                            unsigned numof, const char *(*name)(unsigned, const void *),
+                            uint32_t (*data)(unsigned, const void *), const void *ctx)
 {
-    static unsigned combinations;
-
-    if (combinations == 0) {
-        combinations = fsk_fec.num_settings * fsk_mord.num_settings
-                     * fsk_srate.num_settings * fsk_idx.num_settings;
-    }
-
-    return combinations;
-}
+    uint16_t mask = 0;
 
-static int _set_FSK(unsigned setting, bool do_set)
-{
-    for (unsigned i = 0; i < fsk_srate.num_settings; ++i) {
-        for (unsigned j = 0; j < fsk_idx.num_settings; ++j) {
-            for (unsigned k = 0; k < fsk_mord.num_settings; ++k) {
-                for (unsigned l = 0; l < fsk_fec.num_settings; ++l) {
-                    if (setting-- == 0) {
-                        printf("FSK ");
-                        _set_from_netopt_list(&fsk_srate, i, do_set);
-                        printf(", ");
-                        _set_from_netopt_list(&fsk_idx, j, do_set);
-                        printf(", ");
-                        _set_from_netopt_list(&fsk_mord, k, do_set);
-                        printf(", ");
-                        _set_from_netopt_list(&fsk_fec, l, do_set);
-                        return 0;
-                    }
-                }
+    for (unsigned v = 0; v < numof; ++v) {
+        if (op[0] != '=') {
+            uint32_t limit = strtoul(arg, NULL, 10);
+            if (op[0] == '>' ? data(v, ctx) >= limit : data(v, ctx) <= limit) {
+                mask |= 1 << v;
             }
+            continue;
         }
-    }
 
-    return -1;
-}
+        /* match either the name or the value */
+        for (const char *item = arg; item; item = strchr(item, ',')) {
+            if (*item == ',') {
+                ++item;
+            }
 
-static int _print_FSK(char *str, size_t len, unsigned setting)
-{
-    for (unsigned i = 0; i < oqpsk_rates.num_settings; ++i) {
-        for (unsigned j = 0; j < oqpsk_chips.num_settings; ++j) {
-            for (unsigned k = 0; k < fsk_mord.num_settings; ++k) {
-                for (unsigned l = 0; l < fsk_fec.num_settings; ++l) {
-                    if (setting-- == 0) {
-                        int res, total = 0;
-                        res = snprintf(str, len, "FSK ");
-                        total += _advance_str(&str, &len, res);
-                        res = _print_from_netopt_list(str, len, &fsk_srate, i);
-                        total += _advance_str(&str, &len, res);
-                        res = snprintf(str, len, ", ");
-                        total += _advance_str(&str, &len, res);
-                        res = _print_from_netopt_list(str, len, &fsk_idx, j);
-                        total += _advance_str(&str, &len, res);
-                        res = snprintf(str, len, ", ");
-                        total += _advance_str(&str, &len, res);
-                        res = _print_from_netopt_list(str, len, &fsk_mord, k);
-                        total += _advance_str(&str, &len, res);
-                        res = snprintf(str, len, ", ");
-                        total += _advance_str(&str, &len, res);
-                        res = _print_from_netopt_list(str, len, &fsk_fec, l);
-                        total += _advance_str(&str, &len, res);
-                        return total;
-                    }
-                }
+            size_t len = strcspn(item, ",");
+            const char *n = name ? name(v, ctx) : NULL;
+            char *end;
+            uint32_t val = strtoul(item, &end, 10);
+
+            if ((n && strlen(n) == len && strncasecmp(n, item, len) == 0) ||
+                (end != item && end == item + len && val == data(v, ctx))) {
+                mask |= 1 << v;
             }
         }
     }
 
-    return 0;
+    return mask;
 }
-#else
-static unsigned _get_FSK_combinations(void)
+
+static const char *_list_name(unsigned v, const void *ctx)
 {
-    return 0;
+    return ((const netopt_list_t *)ctx)->settings[v].name;
 }
 
-static int _set_FSK(unsigned setting, bool do_set)
+static uint32_t _list_data(unsigned v, const void *ctx)
 {
-    (void) setting;
-    (void) do_set;
-
-    return -1;
+    return ((const netopt_list_t *)ctx)->settings[v].data;
 }
 
-static int _print_FSK(char *str, size_t len, unsigned setting)
+static uint32_t _payload_data(unsigned v, const void *ctx)
 {
-    (void)str;
-    (void)len;
-    (void)setting;
-
-    return 0;
+    (void)ctx;
+    return payloads[v];
 }
-#endif  /* OFDM */
 
-static unsigned _get_combinations(void)
+bool range_test_sweeping(void)
 {
-    return _get_OFDM_combinations() + _get_OQPSK_combinations()
-         + _get_legacy_OQPSK_combinations() + _get_FSK_combinations();
+    return sweeping;
 }
 
-static int _set(unsigned idx, bool do_set)
+int range_test_plan_cmd(int argc, char **argv)
 {
-    if (idx < _get_OQPSK_combinations()) {
-        return _set_OQPSK(idx, do_set);
-    } else {
-        idx -= _get_OQPSK_combinations();
-    }
+    range_plan_t plan;
+    unsigned group = 0;     /* PHYs the following options apply to */
+    bool any_phy = false;
 
-    if (idx < _get_legacy_OQPSK_combinations()) {
-        return _set_legacy_OQPSK(idx, do_set);
-    } else {
-        idx -= _get_legacy_OQPSK_combinations();
+    if (argc == 1) {
+        _plan_print();
+        return 0;
     }
 
-    if (idx < _get_OFDM_combinations()) {
-        return _set_OFDM(idx, do_set);
-    } else {
-        idx -= _get_OFDM_combinations();
+    if (range_test_sweeping()) {
+        puts("a range test is running, change the plan once it is done");
+        return -1;
     }
 
-    if (idx < _get_FSK_combinations()) {
-        return _set_FSK(idx, do_set);
-    } else {
-        idx -= _get_FSK_combinations();
-    }
+    memset(&plan, 0, sizeof(plan));
+    plan.payloads = UINT16_MAX;
 
-    return -1;
-}
+    for (int i = 1; i < argc; ++i) {
+        if (strcasecmp(argv[i], "all") == 0) {
+            memset(&plan, 0xff, sizeof(plan));
+            any_phy = true;
+            continue;
+        }
 
-static int _print(char *str, size_t len, unsigned idx)
-{
-    if (idx < _get_OQPSK_combinations()) {
-        return _print_OQPSK(str, len, idx);
-    } else {
-        idx -= _get_OQPSK_combinations();
-    }
+        /* a PHY name enables the PHY with all its values */
+        unsigned match = 0;
+        for (unsigned p = 0; p < ARRAY_SIZE(sweep_phys); ++p) {
+            if (strcasecmp(argv[i], sweep_phys[p].name) == 0) {
+                memset(plan.values[p], 0xff, sizeof(plan.values[p]));
+                match |= 1 << p;
+            }
+        }
+        if (match) {
+            group = match;
+            any_phy = true;
+            continue;
+        }
 
-    if (idx < _get_legacy_OQPSK_combinations()) {
-        return _print_legacy_OQPSK(str, len, idx);
-    } else {
-        idx -= _get_legacy_OQPSK_combinations();
-    }
+        /* option, followed by =, >= or <= */
+        size_t len = strcspn(argv[i], "=<>");
+        const char *op = &argv[i][len];
+        const char *arg = op + (op[0] == '=' ? 1 : 2);
 
-    if (idx < _get_OFDM_combinations()) {
-        return _print_OFDM(str, len, idx);
-    } else {
-        idx -= _get_OFDM_combinations();
-    }
+        if (op[0] == 0 || (op[0] != '=' && op[1] != '=')) {
+            printf("can't parse '%s'\n", argv[i]);
+            goto usage;
+        }
 
-    if (idx < _get_FSK_combinations()) {
-        return _print_FSK(str, len, idx);
-    } else {
-        idx -= _get_FSK_combinations();
-    }
+        if (len == strlen("payload") && strncasecmp(argv[i], "payload", len) == 0) {
+            plan.payloads &= _plan_match(op, arg, ARRAY_SIZE(payloads),
+                                         NULL, _payload_data, NULL);
+            continue;
+        }
 
-    return 0;
-}
+        match = 0;
+        for (unsigned p = 0; p < ARRAY_SIZE(sweep_phys); ++p) {
+            if (!(group & (1 << p))) {
+                continue;
+            }
 
-static void _set_modulation(unsigned idx)
-{
-    printf("[%d] Set ", idx);
+            for (unsigned d = 0; d < sweep_phys[p].dim_numof; ++d) {
+                const netopt_list_t *l = sweep_phys[p].dim[d];
+                if (strlen(l->name) == len && strncasecmp(l->name, argv[i], len) == 0) {
+                    plan.values[p][d] &= _plan_match(op, arg, l->num_settings,
+                                                     _list_name, _list_data, l);
+                    match = 1;
+                }
+            }
+        }
 
-#ifdef TEST_OQPSK
-    if (idx == 0) {
-        uint32_t data = IEEE802154_PHY_MR_OQPSK;
-        _netapi_set_forall(NETOPT_IEEE802154_PHY, &data, 1);
-    }
-#endif
-#ifdef TEST_LEGCAY_OQPSK
-    if (idx == _get_OQPSK_combinations()) {
-        uint32_t data = IEEE802154_PHY_OQPSK;
-        _netapi_set_forall(NETOPT_IEEE802154_PHY, &data, 1);
-    }
-#endif
-#ifdef TEST_OFDM
-    if (idx == _get_OQPSK_combinations() + _get_legacy_OQPSK_combinations()) {
-        uint32_t data = IEEE802154_PHY_MR_OFDM;
-        _netapi_set_forall(NETOPT_IEEE802154_PHY, &data, 1);
-    }
-#endif
-#ifdef TEST_FSK
-    if (idx == _get_OFDM_combinations() + _get_OQPSK_combinations() + _get_legacy_OQPSK_combinations()) {
-        uint32_t data = IEEE802154_PHY_MR_FSK;
-        _netapi_set_forall(NETOPT_IEEE802154_PHY, &data, 1);
+        if (!match) {
+            printf("unknown option '%.*s'\n", (int)len, argv[i]);
+            goto usage;
+        }
     }
-#endif
-
-    _set(idx, true);
 
-    puts("");
-}
-
-void range_test_begin_measurement(kernel_pid_t netif)
-{
-    unsigned _idx = idx * ARRAY_SIZE(payloads) + _payload_idx;
-    netif -= range_test_radio_pid();
+    /* only payloads given */
+    if (!any_phy) {
+        memset(plan.values, 0xff, sizeof(plan.values));
+    }
 
-    if (results[netif] == NULL) {
-        results[netif] = calloc(_get_combinations() * ARRAY_SIZE(payloads), sizeof(test_result_t));
-        if (results[netif] == NULL) {
-            puts("Out of memory!");
-            return;
-        }
+    bool empty = true;
+    for (unsigned p = 0; p < ARRAY_SIZE(sweep_phys); ++p) {
+        empty &= !_plan_phy_selected(&plan, p);
     }
 
-    results[netif][_idx].pkts_send++;
-    if (results[netif][_idx].rtt_ticks == 0) {
-        results[netif][_idx].rtt_ticks = max_delay_ms[_payload_idx] * US_PER_MS;
+    if (empty || (plan.payloads & ((1 << ARRAY_SIZE(payloads)) - 1)) == 0) {
+        puts("nothing selected");
+        return -1;
     }
-}
 
-uint32_t range_test_get_timeout(kernel_pid_t netif)
-{
-    netif -= range_test_radio_pid();
+    range_test_plan_set(&plan);
+    _plan_print();
 
-    unsigned _idx = idx * ARRAY_SIZE(payloads) + _payload_idx;
-    uint32_t t = results[netif][_idx].rtt_ticks
-               + results[netif][_idx].rtt_ticks / 10;
+    return 0;
 
-    return t;
+usage:
+    printf("usage: %s [all] [phy [option=value[,value…]|option>=value|option<=value]…]… "
+           "[payload=size[,size…]]\n", argv[0]);
+    return -1;
 }
 
-void range_test_add_measurement(kernel_pid_t netif, uint32_t ticks,
-                                int rssi_local, int rssi_remote,
-                                unsigned lqi_local, unsigned lqi_remote,
-                                uint16_t payload_size)
+/* PDR of every radio is known to ±margin % with the confidence of EARLY_STOP_Z2 */
+bool range_test_pdr_converged(unsigned margin)
 {
-    unsigned _idx = idx * ARRAY_SIZE(payloads) + _payload_idx;
-    netif -= range_test_radio_pid();
-
-    results[netif][_idx].pkts_rcvd++;
-    results[netif][_idx].rssi_sum[0] += rssi_local;
-    results[netif][_idx].rssi_sum[1] += rssi_remote;
-    results[netif][_idx].lqi_sum[0] += lqi_local;
-    results[netif][_idx].lqi_sum[1] += lqi_remote;
-    results[netif][_idx].rtt_ticks = ticks;
-    results[netif][_idx].payload_size = payload_size;
-}
+    /* rule of three, no loss (or no reception) in 3/ε tries bounds the PDR */
+    unsigned n_min = (300 + margin - 1) / margin;
+    uint64_t margin2 = margin * margin;
 
-void range_test_print_results(void)
-{
-    printf("modulation;payload;iface;sent;received;LQI_local;LQI_remote;RSSI_local;RSSI_remote;RTT\n");
-    for (unsigned i = 0; i < _get_combinations() * ARRAY_SIZE(payloads); ++i) {
-        for (unsigned j = 0; j < range_test_radio_numof(); ++j) {
-            uint32_t ticks = results[j][i].rtt_ticks;
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        const test_result_t *res = &results[i];
+        uint64_t k = res->pkts_rcvd;
+        uint64_t n = k + res->pkts_lost;
 
-            printf("\"");
-            _set(i / ARRAY_SIZE(payloads), false);
-            printf("\";");
+        if (res->invalid) {
+            continue;
+        }
 
-            if (results[j][i].invalid) {
-                puts(" INVALID");
-            } else {
-                printf("%d;", j);
-                printf("%d;", results[j][i].payload_size);
-                printf("%d;", results[j][i].pkts_send);
-                printf("%d;", results[j][i].pkts_rcvd);
-                printf("%ld;", results[j][i].lqi_sum[0] / results[j][i].pkts_rcvd);
-                printf("%ld;", results[j][i].lqi_sum[1] / results[j][i].pkts_rcvd);
-                printf("%ld;", results[j][i].rssi_sum[0] / results[j][i].pkts_rcvd);
-                printf("%ld;", results[j][i].rssi_sum[1] / results[j][i].pkts_rcvd);
-                printf("%ld", xtimer_usec_from_ticks(ticks));
-                printf("\t|\t%d %%", (100 * results[j][i].pkts_rcvd) / results[j][i].pkts_send);
-                printf(" max = %lu byte/s", (results[j][i].payload_size * US_PER_SEC) / ticks);
-                printf(" avg = %lu byte/s", (results[j][i].pkts_rcvd * results[j][i].payload_size * 1000) /
-                                            range_test_period_ms());
-                puts("");
-            }
+        if (n < n_min) {
+            return false;
+        }
 
-            memset(&results[j][i], 0, sizeof(results[j][i]));
+        /* z² · p(1-p) / n <= ε², normal approximation without division */
+        if (EARLY_STOP_Z2 * k * (n - k) * 100 > margin2 * n * n * n) {
+            return false;
         }
     }
 
-    range_test_start();
-}
-
-uint16_t range_test_payload_size(void)
-{
-    return payloads[_payload_idx];
+    return true;
 }
 
 bool range_test_set_next_modulation(void)
 {
+    uint32_t now = xtimer_now();
+
+    /* the setting is done, keep it for the report and make room for the next one */
     for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
-        file_store_add(i, &results[i][idx * ARRAY_SIZE(payloads) + _payload_idx]);
+        test_result_t *result = &results[i];
+        result->dwell_ms = (now - step_start) / US_PER_MS;
+        _hist_finish(rtt_hist[i], result);
+        _stats_finish(rx_stats[i], result);
+        report[i].pending = _radio_active(i, idx);
+        if (report[i].pending) {
+            report[i].result = *result;
+            report[i].step   = sweep_plan[i].setting * ARRAY_SIZE(payloads) + _payload();
+        }
+        memset(result, 0, sizeof(*result));
+        result->invalid = setting_failed[i];
     }
+    step_start = now;
 
-    if (++_payload_idx < ARRAY_SIZE(payloads)) {
+    if (++_payload_idx < plan_payload_numof) {
+        if (reapply) {
+            _set_modulation(idx);
+        }
         printf("\tusing %u byte payload\n", range_test_payload_size());
         return true;
     }
     _payload_idx = 0;
 
-    if (++idx >= _get_combinations()) {
+    if (++idx >= _get_rounds()) {
         return false;
     }
 
@@ -963,27 +2048,97 @@ bool range_test_set_next_modulation(void)
     return true;
 }
 
+/* print and log the settings left by range_test_set_next_modulation(),
+ * only the coordinator measures, and not on the timed switch */
+void range_test_report(void)
+{
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        if (!report[i].pending) {
+            continue;
+        }
+
+        file_store_add(i, report[i].step, &report[i].result);
+        _print_result(i, report[i].step, &report[i].result);
+        report[i].pending = false;
+    }
+}
+
 void range_test_init(void)
 {
+    /* the busy radio's events are needed to configure it */
+    range_test_radio_events_init();
+
     netopt_enable_t disable = NETOPT_DISABLE;
     _netapi_set_forall(NETOPT_ACK_REQ, &disable, sizeof(disable));
 
+    /* we want to know how long a frame is on air */
+    netopt_enable_t enable = NETOPT_ENABLE;
+    _netapi_set_forall(NETOPT_TX_START_IRQ, &enable, sizeof(enable));
+    _netapi_set_forall(NETOPT_TX_END_IRQ, &enable, sizeof(enable));
+    _netapi_set_forall(NETOPT_RX_START_IRQ, &enable, sizeof(enable));
+    _netapi_set_forall(NETOPT_RX_END_IRQ, &enable, sizeof(enable));
+
+    _sweep_init();
+
     idx = 0;
+    _payload_idx = 0;
     LED0_OFF;
     _set_modulation(idx);
 }
 
-void range_test_start(void)
+void range_test_start(unsigned step)
 {
-    static unsigned count;
-    file_store_open(count++);
+    sweeping = true;
+
+    /* a resumed sweep continues its log */
+    if (step == 0 || file_store_resume() < 0) {
+        /* the checkpoint would point into the log we replace */
+        range_test_store_checkpoint_clear();
+        file_store_open();
+    }
+
+    if (step >= range_test_step_numof()) {
+        step = 0;
+    }
+
+    /* the plan was changed since the radios were configured */
+    idx = step / plan_payload_numof;
+    _payload_idx = step % plan_payload_numof;
+    if (reapply || idx) {
+        _set_modulation(idx);
+    }
+
+    printf("%u steps, at most %lu s\n", range_test_step_numof(),
+           (unsigned long)(_plan_duration_ms() / MS_PER_SEC));
+    if (step) {
+        printf("resuming at step %u\n", step);
+    }
+
+    memset(results, 0, sizeof(results));
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        results[i].invalid = setting_failed[i];
+    }
+    memset(rtt_hist, 0, sizeof(rtt_hist));
+    memset(rx_stats, 0, sizeof(rx_stats));
+    memset(&reconf_stats, 0, sizeof(reconf_stats));
+    _print_header();
+
+    step_start = xtimer_now();
 }
 
 void range_test_end(void)
 {
     file_store_close();
 
+    printf("reconfiguration: %lu options set, %lu unchanged, %lu ms, "
+           "%lu waits for busy radios, %lu timeouts\n",
+           (unsigned long)reconf_stats.sets, (unsigned long)reconf_stats.skipped,
+           (unsigned long)(reconf_stats.time_us / US_PER_MS),
+           (unsigned long)reconf_stats.waits, (unsigned long)reconf_stats.timeouts);
+
+    sweeping = false;
     idx = 0;
+    _payload_idx = 0;
     LED0_OFF;
     _set_modulation(idx);
 }
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2019 ML!PA Consulting GmbH
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     examples
+ * @{
+ *
+ * @file
+ * @brief       Timestamps from the netdev events of the radios
+ *
+ * gnrc_netif owns the event callback of the netdev, so we install our
+ * own callback in front of it and forward every event.
+ *
+ * @author      Benjamin Valentin <benjamin.valentin@ml-pa.com>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+#include "msg.h"
+#include "mutex.h"
+#include "net/gnrc.h"
+#include "net/gnrc/netif.h"
+
+#include "range_test.h"
+
+/* no new frame started within that time - TX queue is empty */
+#define TX_IDLE_GAP_US  (10 * US_PER_MS)
+
+typedef struct {
+    netdev_t *dev;
+    netdev_event_cb_t cb;       /* gnrc_netif's event callback */
+    kernel_pid_t waiter;        /* thread to notify on TX completion */
+    mutex_t *idle;              /* unlocked when a TX or RX is over */
+    uint32_t *tx_stamp;         /* gets the start of the next frame */
+    uint32_t tx_start;
+    uint32_t tx_airtime;        /* since range_test_radio_tx_begin() */
+    uint16_t tx_frames;
+    uint32_t rx_start;
+    uint32_t rx_done;
+} radio_events_t;
+
+static radio_events_t radio[GNRC_NETIF_NUMOF];
+
+static radio_events_t *_get_by_dev(netdev_t *dev)
+{
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        if (radio[i].dev == dev) {
+            return &radio[i];
+        }
+    }
+
+    return NULL;
+}
+
+static radio_events_t *_get_by_pid(kernel_pid_t netif)
+{
+    return &radio[netif - range_test_radio_pid()];
+}
+
+static void _event_cb(netdev_t *dev, netdev_event_t event)
+{
+    radio_events_t *r = _get_by_dev(dev);
+
+    /* events other than ISR are reported in the netif thread */
+    if (event != NETDEV_EVENT_ISR) {
+        uint32_t now = xtimer_now();
+
+        switch (event) {
+        case NETDEV_EVENT_TX_STARTED:
+            r->tx_start = now;
+            if (r->tx_stamp) {
+                *r->tx_stamp = now;
+                r->tx_stamp = NULL;
+            }
+            break;
+        case NETDEV_EVENT_TX_COMPLETE:
+            if (r->tx_start) {
+                r->tx_airtime += now - r->tx_start;
+                r->tx_frames++;
+                r->tx_start = 0;
+            }
+            if (r->waiter != KERNEL_PID_UNDEF) {
+                msg_t m = {
+                    .type = CUSTOM_MSG_TYPE_TX_DONE
+                };
+                msg_try_send(&m, r->waiter);
+            }
+            break;
+        case NETDEV_EVENT_RX_STARTED:
+            r->rx_start = now;
+            break;
+        case NETDEV_EVENT_RX_COMPLETE:
+            r->rx_done = now;
+            break;
+        default:
+            break;
+        }
+
+        switch (event) {
+        case NETDEV_EVENT_TX_COMPLETE:
+        case NETDEV_EVENT_TX_NOACK:
+        case NETDEV_EVENT_TX_MEDIUM_BUSY:
+        case NETDEV_EVENT_RX_COMPLETE:
+        case NETDEV_EVENT_CRC_ERROR:
+            if (r->idle) {
+                mutex_unlock(r->idle);
+                r->idle = NULL;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    r->cb(dev, event);
+}
+
+void range_test_radio_events_init(void)
+{
+    for (unsigned i = 0; i < range_test_radio_numof(); ++i) {
+        gnrc_netif_t *netif = gnrc_netif_get_by_pid(range_test_radio_pid() + i);
+
+        if (radio[i].dev) {
+            continue;
+        }
+
+        unsigned state = irq_disable();
+        radio[i].dev = netif->dev;
+        radio[i].cb  = netif->dev->event_callback;
+        netif->dev->event_callback = _event_cb;
+        irq_restore(state);
+    }
+}
+
+void range_test_radio_tx_begin(kernel_pid_t netif)
+{
+    radio_events_t *r = _get_by_pid(netif);
+
+    unsigned state = irq_disable();
+    r->tx_airtime = 0;
+    r->tx_frames  = 0;
+    r->waiter     = thread_getpid();
+    irq_restore(state);
+}
+
+unsigned range_test_radio_tx_wait(kernel_pid_t netif, uint32_t timeout, uint32_t *airtime)
+{
+    radio_events_t *r = _get_by_pid(netif);
+    msg_t m, wakeup = { .type = 0 };
+
+    /* a fragmented packet is sent as several frames */
+    while (xtimer_msg_receive_timeout(&m, timeout) > 0) {
+        if (m.type == CUSTOM_MSG_TYPE_TX_DONE) {
+            timeout = TX_IDLE_GAP_US;
+        } else if (wakeup.type != CUSTOM_MSG_TYPE_STOP) {
+            wakeup = m;
+        }
+    }
+
+    /* a PONG or STOP is meant for the caller, a STOP wins */
+    if (wakeup.type) {
+        msg_send_to_self(&wakeup);
+    }
+
+    unsigned state = irq_disable();
+    unsigned frames = r->tx_frames;
+    *airtime = r->tx_airtime;
+    r->waiter = KERNEL_PID_UNDEF;
+    irq_restore(state);
+
+    return frames;
+}
+
+/* frames sent since range_test_radio_tx_begin() */
+unsigned range_test_radio_tx_frames(kernel_pid_t netif)
+{
+    return _get_by_pid(netif)->tx_frames;
+}
+
+/* the start of the next frame on air is written to at, 0 until then */
+void range_test_radio_tx_stamp(kernel_pid_t netif, uint32_t *at)
+{
+    radio_events_t *r = _get_by_pid(netif);
+
+    unsigned state = irq_disable();
+    *at = 0;
+    r->tx_stamp = at;
+    irq_restore(state);
+}
+
+/* end of the last frame received */
+uint32_t range_test_radio_rx_done(kernel_pid_t netif)
+{
+    return _get_by_pid(netif)->rx_done;
+}
+
+/* the radio will accept a new configuration, once the current
+ * transmission or reception is over */
+void range_test_radio_idle_arm(kernel_pid_t netif, mutex_t *idle)
+{
+    radio_events_t *r = _get_by_pid(netif);
+
+    unsigned state = irq_disable();
+    r->idle = idle;
+    irq_restore(state);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 ML!PA Consulting GmbH
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     examples
+ * @{
+ *
+ * @file
+ * @brief       Binary result log, shared with the host side decoder
+ *
+ * A log starts with a header that describes the sweep:
+ *
+ *   range_log_hdr_t
+ *   uint16_t payload size, payload_numof times
+ *   per PHY: uint8_t phy, uint8_t dim_numof, str name
+ *     per dimension: str name, uint8_t value_numof, value_numof str
+ *
+ * where a str is a uint8_t length followed by the characters.
+ * After that come range_log_rec_t records until the end of the file.
+ * The setting index is the mixed-radix number of the option values,
+ * the first dimension of a PHY is the most significant digit and the
+ * PHYs follow each other in the order of the header.
+ *
+ * All fields are little endian. This header must not depend on RIOT.
+ *
+ * New fields are only ever appended to range_log_rec_t, a reader takes
+ * rec_size as the key to what a log contains: it reads the prefix it
+ * knows and treats missing fields as 0. RANGE_LOG_VERSION only changes
+ * if existing fields change.
+ *
+ * @author      Benjamin Valentin <benjamin.valentin@ml-pa.com>
+ *
+ * @}
+ */
+
+#ifndef RANGE_LOG_H
+#define RANGE_LOG_H
+
+#include <stdint.h>
+
+#define RANGE_LOG_MAGIC         (0x4c544752)    /* "RGTL" */
+#define RANGE_LOG_VERSION       (1)
+
+/* unit of the RTT fields, saturated at UINT16_MAX */
+#define RANGE_LOG_RTT_US        (32)
+/* unit of the airtime field */
+#define RANGE_LOG_AIRTIME_US    (16)
+
+/* nothing was received to take RSSI, LQI and RTT from, e.g. when streaming */
+#define RANGE_LOG_FLAG_NO_RX    (0x1)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t rec_size;           /* sizeof(range_log_rec_t) */
+    uint8_t phy_numof;
+    uint8_t payload_numof;
+} range_log_hdr_t;
+
+/* RSSI or LQI over one setting, mean and sdev in 1/10,
+ * min and max are int8_t for RSSI */
+typedef struct __attribute__((packed)) {
+    int16_t mean;
+    uint16_t sdev;
+    uint8_t min;
+    uint8_t max;
+} range_log_link_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t step;              /* setting * payload_numof + payload index */
+    uint8_t iface;
+    uint8_t frames;
+    uint16_t payload_size;
+    uint16_t sent;
+    uint16_t received;
+    range_log_link_t rssi[2];   /* local, remote */
+    range_log_link_t lqi[2];    /* local, remote */
+    uint16_t rtt_last;
+    uint16_t rtt_mean;
+    uint16_t rtt_sdev;
+    uint16_t rtt_min;
+    uint16_t rtt_max;
+    uint16_t rtt_pct[3];        /* upper bound of p50, p90, p99 */
+    uint16_t airtime;
+    uint16_t reconf;            /* radio configuration time, RTT unit */
+    uint32_t goodput;           /* byte/s in streaming mode, 0 otherwise */
+    uint16_t fwd_received;      /* pings the responder received */
+    uint16_t dups;
+    uint16_t reordered;
+    uint16_t uplink;            /* mean one-way delays and responder time, RTT unit */
+    uint16_t turnaround;
+    uint16_t downlink;
+    uint16_t radio;             /* RTT between the radio events, RTT unit */
+    uint16_t stack;             /* and what the coordinator's stack adds */
+    uint8_t flags;              /* RANGE_LOG_FLAG_… */
+} range_log_rec_t;
+
+#endif /* RANGE_LOG_H */
@@ -22,40 +22,174 @@
 #define RANGE_TEST_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "mutex.h"
 #include "xtimer.h"
 
+#define RTT_PERCENTILES_NUMOF   (3)
+
+/* spread of RSSI or LQI over a setting, mean and sdev in 1/10 */
+typedef struct {
+    int16_t mean;
+    uint16_t sdev;
+    int16_t min;
+    int16_t max;
+} link_stat_t;
+
+/* spread of the RTT over a setting in µs */
+typedef struct {
+    uint32_t mean;
+    uint32_t sdev;
+    uint32_t min;
+    uint32_t max;
+} rtt_stat_t;
+
+/* ordered by size to keep the padding small */
 typedef struct {
+    rtt_stat_t rtt;
+    uint32_t rtt_ticks;
+    uint32_t srtt;
+    uint32_t rttvar;
+    uint32_t airtime;
+    uint32_t dwell_ms;          /* time spent on the setting */
+    uint32_t reconf_us;         /* time to configure the radio for the setting */
+    uint32_t goodput;           /* byte/s received by the responder when streaming */
+    uint32_t uplink_us;         /* mean one-way delay to the responder */
+    uint32_t turnaround_us;     /* mean processing time on the responder */
+    uint32_t downlink_us;       /* mean one-way delay back */
+    uint32_t radio_us;          /* mean ping TX start to pong RX end, less turnaround */
+    uint32_t stack_us;          /* mean time the coordinator's stack adds to that */
+    link_stat_t rssi[2];        /* local, remote */
+    link_stat_t lqi[2];         /* local, remote */
     uint16_t pkts_send;
     uint16_t pkts_rcvd;
-    int32_t rssi_sum[2];
-    uint32_t lqi_sum[2];
-    uint32_t rtt_ticks;
+    uint16_t pkts_lost;
+    uint16_t pkts_late;         /* pongs that came after their ping timed out */
     uint16_t payload_size;
+    uint16_t fwd_rcvd;          /* pings the responder received */
+    uint16_t dups;              /* pings the responder received twice */
+    uint16_t reordered;         /* pings that overtook an earlier one */
+    uint16_t radio_samples;     /* pongs with usable radio timestamps */
+    uint16_t rx_samples;        /* pongs RSSI, LQI and RTT were taken from */
+    uint8_t frames;
+    uint8_t backoff;
+    uint8_t rtt_pct[RTT_PERCENTILES_NUMOF];  /* RTT histogram buckets */
     bool invalid;
 } test_result_t;
 
+/* option values of a PHY setting */
+typedef struct {
+    uint8_t phy;
+    uint8_t ofdm_option;
+    uint8_t ofdm_mcs;
+    uint8_t oqpsk_rate;
+    uint16_t oqpsk_chips;   /* kchip/s */
+    uint16_t fsk_srate;     /* ksymbol/s */
+    uint8_t fsk_mord;
+    uint8_t fsk_fec;
+} phy_cfg_t;
+
+/* settings and payloads to sweep, sent to the responder in the handshake */
+#define RANGE_PLAN_PHY_MAX  (4)
+#define RANGE_PLAN_DIM_MAX  (4)
+
+typedef struct {
+    uint16_t payloads;      /* bit per payload size */
+    uint16_t values[RANGE_PLAN_PHY_MAX][RANGE_PLAN_DIM_MAX];   /* bit per option value */
+} range_plan_t;
+
 void range_test_init(void);
-void range_test_start(void);
+void range_test_start(unsigned step);
 void range_test_end(void);
+bool range_test_sweeping(void);
 bool range_test_set_next_modulation(void);
+void range_test_report(void);
+unsigned range_test_step(void);
+bool range_test_setting_boundary(void);
+unsigned range_test_step_numof(void);
+void range_test_goto(unsigned step);
+void range_test_rendezvous(void);
+void range_test_plan_get(range_plan_t *plan);
+void range_test_plan_set(const range_plan_t *plan);
+int range_test_plan_cmd(int argc, char **argv);
+bool range_test_pdr_converged(unsigned margin);
 uint32_t range_test_get_timeout(kernel_pid_t netif);
 
 void range_test_begin_measurement(kernel_pid_t netif);
+void range_test_cancel_measurement(kernel_pid_t netif, unsigned pings);
 void range_test_add_measurement(kernel_pid_t netif, uint32_t ticks,
                                 int rssi_local, int rssi_remote,
                                 unsigned lqi_local, unsigned lqi_remote,
                                 uint16_t payload_size);
-void range_test_print_results(void);
+void range_test_add_timeout(kernel_pid_t netif, unsigned lost);
+void range_test_add_late(kernel_pid_t netif);
+void range_test_add_oneway(kernel_pid_t netif, uint32_t uplink,
+                           uint32_t turnaround, uint32_t downlink);
+void range_test_add_radio_time(kernel_pid_t netif, uint32_t radio, uint32_t stack);
+void range_test_add_forward(kernel_pid_t netif, unsigned rcvd,
+                            unsigned dups, unsigned reordered);
+void range_test_invalidate(kernel_pid_t netif);
+void range_test_add_stream(kernel_pid_t netif, unsigned rcvd, uint32_t bytes, uint32_t span_us);
+void range_test_set_airtime(kernel_pid_t netif, uint32_t airtime, unsigned frames);
 
 uint32_t range_test_period_ms(void);
 uint16_t range_test_payload_size(void);
+void range_test_set_payload_min(uint16_t len);
+bool range_test_raw_mode(void);
+void range_test_set_adaptive_dwell(bool on);
+uint32_t range_test_dwell_ms(unsigned ahead);
+uint32_t range_test_control_timeout(unsigned len);
+
+uint32_t range_test_airtime_frame(const phy_cfg_t *cfg, unsigned psdu_len);
+uint32_t range_test_airtime_packet(const phy_cfg_t *cfg, unsigned len, bool raw,
+                                   unsigned *frames);
 
 unsigned range_test_radio_pid(void);
 unsigned range_test_radio_numof(void);
+bool range_test_radio_active(kernel_pid_t netif);
+
+unsigned range_test_store_next(void);
+void range_test_store_open(unsigned num);
+void range_test_store_write(const void *data, size_t len);
+int range_test_store_write_all(const void *data, size_t len);
+void range_test_store_close(void);
+int range_test_store_resume(void);
+void range_test_store_checkpoint(const void *data, size_t len);
+int range_test_store_checkpoint_load(void *data, size_t len);
+void range_test_store_checkpoint_clear(void);
+
+void range_test_sync_reset(void);
+void range_test_sync_add(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4);
+uint32_t range_test_sync_to_remote(uint32_t local);
+uint32_t range_test_sync_to_local(uint32_t remote);
+void range_test_sync_print(void);
+
+void range_test_radio_events_init(void);
+void range_test_radio_tx_begin(kernel_pid_t netif);
+unsigned range_test_radio_tx_wait(kernel_pid_t netif, uint32_t timeout, uint32_t *airtime);
+unsigned range_test_radio_tx_frames(kernel_pid_t netif);
+void range_test_radio_idle_arm(kernel_pid_t netif, mutex_t *idle);
+void range_test_radio_tx_stamp(kernel_pid_t netif, uint32_t *at);
+uint32_t range_test_radio_rx_done(kernel_pid_t netif);
+
+#define CUSTOM_MSG_TYPE_NEXT_SETTING    (0x0001)
+#define CUSTOM_MSG_TYPE_PONG            (0x0002)
+#define CUSTOM_MSG_TYPE_STOP            (0x0003)
+#define CUSTOM_MSG_TYPE_TX_DONE         (0x0004)
+#define CUSTOM_MSG_TYPE_SWITCH_ACK      (0x0005)
+#define CUSTOM_MSG_TYPE_SUMMARY         (0x0006)
+#define CUSTOM_MSG_TYPE_HELLO_ACK       (0x0007)
 
 #define GNRC_NETIF_NUMOF (2) // FIXME
 
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+#ifndef MIN
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#endif
+
 #define CONFIG_NETDEV_TYPE  NETDEV_AT86RF215
 
 #endif
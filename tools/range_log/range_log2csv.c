@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2019 ML!PA Consulting GmbH
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Converts a binary range test log to CSV
+ *
+ * Usage: range_log2csv <log.bin>
+ *
+ * Assumes a little endian host.
+ *
+ * @author      Benjamin Valentin <benjamin.valentin@ml-pa.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "range_log.h"
+
+#define PHY_MAX     (16)
+#define DIM_MAX     (8)
+#define VAL_MAX     (64)
+
+typedef struct {
+    const char *str;
+    unsigned len;
+} str_t;
+
+typedef struct {
+    str_t name;
+    unsigned value_numof;
+    str_t value[VAL_MAX];
+} dim_t;
+
+typedef struct {
+    str_t name;
+    unsigned dim_numof;
+    dim_t dim[DIM_MAX];
+    unsigned first;
+    unsigned stride[DIM_MAX];
+} phy_t;
+
+static const uint8_t *buf;
+static size_t buf_len;
+static size_t pos;
+
+static phy_t phys[PHY_MAX];
+static unsigned phy_numof;
+static uint16_t payloads[256];
+static unsigned payload_numof;
+
+static int _read(void *dst, size_t len)
+{
+    if (pos + len > buf_len) {
+        return -1;
+    }
+
+    memcpy(dst, &buf[pos], len);
+    pos += len;
+    return 0;
+}
+
+static int _read_str(str_t *s)
+{
+    uint8_t len;
+
+    if (_read(&len, 1) || pos + len > buf_len) {
+        return -1;
+    }
+
+    s->str = (const char *)&buf[pos];
+    s->len = len;
+    pos += len;
+    return 0;
+}
+
+static int _read_header(void)
+{
+    range_log_hdr_t hdr;
+
+    if (_read(&hdr, sizeof(hdr))) {
+        return -1;
+    }
+
+    if (hdr.magic != RANGE_LOG_MAGIC) {
+        fprintf(stderr, "not a range test log\n");
+        return -1;
+    }
+
+    if (hdr.version != RANGE_LOG_VERSION) {
+        fprintf(stderr, "unsupported log version %u\n", hdr.version);
+        return -1;
+    }
+
+    if (hdr.phy_numof > PHY_MAX) {
+        fprintf(stderr, "too many PHYs: %u\n", hdr.phy_numof);
+        return -1;
+    }
+
+    payload_numof = hdr.payload_numof;
+    if (_read(payloads, payload_numof * sizeof(payloads[0]))) {
+        return -1;
+    }
+
+    unsigned first = 0;
+
+    phy_numof = hdr.phy_numof;
+    for (unsigned i = 0; i < phy_numof; ++i) {
+        phy_t *phy = &phys[i];
+        uint8_t id, dim_numof;
+
+        if (_read(&id, 1) || _read(&dim_numof, 1) || _read_str(&phy->name)) {
+            return -1;
+        }
+
+        if (dim_numof > DIM_MAX) {
+            fprintf(stderr, "too many options: %u\n", dim_numof);
+            return -1;
+        }
+
+        phy->dim_numof = dim_numof;
+        for (unsigned d = 0; d < dim_numof; ++d) {
+            dim_t *dim = &phy->dim[d];
+            uint8_t value_numof;
+
+            if (_read_str(&dim->name) || _read(&value_numof, 1)) {
+                return -1;
+            }
+
+            if (value_numof > VAL_MAX) {
+                fprintf(stderr, "too many values: %u\n", value_numof);
+                return -1;
+            }
+
+            dim->value_numof = value_numof;
+            for (unsigned v = 0; v < value_numof; ++v) {
+                if (_read_str(&dim->value[v])) {
+                    return -1;
+                }
+            }
+        }
+
+        /* first option is the most significant digit */
+        unsigned stride = 1;
+        for (unsigned d = dim_numof; d > 0; --d) {
+            phy->stride[d - 1] = stride;
+            stride *= phy->dim[d - 1].value_numof;
+        }
+
+        phy->first = first;
+        first += stride;
+    }
+
+    return hdr.rec_size;
+}
+
+static void _print_setting(unsigned setting)
+{
+    unsigned i = phy_numof - 1;
+
+    while (i && setting < phys[i].first) {
+        --i;
+    }
+
+    const phy_t *phy = &phys[i];
+    setting -= phy->first;
+
+    printf("\"%.*s ", phy->name.len, phy->name.str);
+    for (unsigned d = 0; d < phy->dim_numof; ++d) {
+        const dim_t *dim = &phy->dim[d];
+        unsigned v = setting / phy->stride[d];
+        setting %= phy->stride[d];
+
+        if (d) {
+            printf(", ");
+        }
+
+        if (v < dim->value_numof) {
+            printf("%.*s = %.*s", dim->name.len, dim->name.str,
+                   dim->value[v].len, dim->value[v].str);
+        }
+    }
+    printf("\"");
+}
+
+static void _print_tenths(int v)
+{
+    printf("%s%u.%u;", v < 0 ? "-" : "", abs(v) / 10, abs(v) % 10);
+}
+
+static unsigned long _rtt(uint16_t v)
+{
+    return (unsigned long)v * RANGE_LOG_RTT_US;
+}
+
+static void _print_empty(unsigned fields)
+{
+    while (fields--) {
+        printf(";");
+    }
+}
+
+/* same layout as the firmware's _print_result, without the summary */
+static void _print_record(const range_log_rec_t *rec)
+{
+    /* the flags are 0 in older logs */
+    int rx = !(rec->flags & RANGE_LOG_FLAG_NO_RX);
+
+    _print_setting(rec->step / payload_numof);
+
+    printf(";%u;%u;%u;%u;", rec->iface, rec->payload_size, rec->sent, rec->received);
+    if (rx) {
+        _print_tenths(rec->lqi[0].mean);
+        _print_tenths(rec->lqi[1].mean);
+        _print_tenths(rec->rssi[0].mean);
+        _print_tenths(rec->rssi[1].mean);
+        printf("%lu;", _rtt(rec->rtt_last));
+        for (unsigned p = 0; p < sizeof(rec->rtt_pct) / sizeof(rec->rtt_pct[0]); ++p) {
+            /* no percentile is logged as 0 */
+            if (rec->rtt_pct[p]) {
+                printf("%lu;", _rtt(rec->rtt_pct[p]));
+            } else {
+                _print_empty(1);
+            }
+        }
+    } else {
+        _print_empty(5 + 3);
+    }
+    printf("%lu;%u;", (unsigned long)rec->airtime * RANGE_LOG_AIRTIME_US, rec->frames);
+
+    if (rx) {
+        _print_tenths(rec->rssi[0].sdev);
+        _print_tenths(rec->rssi[1].sdev);
+        printf("%lu;%lu;%lu;%lu;", _rtt(rec->rtt_mean), _rtt(rec->rtt_sdev),
+               _rtt(rec->rtt_min), _rtt(rec->rtt_max));
+    } else {
+        _print_empty(6);
+    }
+
+    printf("%lu;%lu", _rtt(rec->reconf), (unsigned long)rec->goodput);
+
+    /* the forward counters are 0 in older logs */
+    printf(";%u;%u;%u", rec->fwd_received, rec->dups, rec->reordered);
+    printf(";%lu;%lu;%lu", _rtt(rec->uplink), _rtt(rec->turnaround), _rtt(rec->downlink));
+    printf(";%lu;%lu\n", _rtt(rec->radio), _rtt(rec->stack));
+}
+
+static int _load(const char *file)
+{
+    FILE *f = fopen(file, "rb");
+    uint8_t *data;
+    long len;
+
+    if (f == NULL) {
+        perror(file);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    data = malloc(len ? len : 1);
+    if (data == NULL || fread(data, 1, len, f) != (size_t)len) {
+        fprintf(stderr, "can't read %s\n", file);
+        fclose(f);
+        free(data);
+        return -1;
+    }
+
+    fclose(f);
+
+    buf = data;
+    buf_len = len;
+    pos = 0;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <log.bin>\n", argv[0]);
+        return 1;
+    }
+
+    if (_load(argv[1])) {
+        return 1;
+    }
+
+    int rec_size = _read_header();
+    if (rec_size <= 0 || payload_numof == 0 || phy_numof == 0) {
+        fprintf(stderr, "invalid header\n");
+        return 1;
+    }
+
+    puts("modulation;iface;payload;sent;received;LQI_local;LQI_remote;RSSI_local;RSSI_remote;RTT;"
+         "RTT_p50;RTT_p90;RTT_p99;airtime;frames;RSSI_local_sd;RSSI_remote_sd;"
+         "RTT_mean;RTT_sd;RTT_min;RTT_max;reconf;goodput;fwd_received;dups;reordered;"
+         "uplink;turnaround;downlink;RTT_radio;RTT_stack");
+
+    /* newer logs may append fields to the record */
+    while (pos + rec_size <= buf_len) {
+        range_log_rec_t rec = { 0 };
+
+        memcpy(&rec, &buf[pos], rec_size < (int)sizeof(rec) ? rec_size : (int)sizeof(rec));
+        pos += rec_size;
+
+        _print_record(&rec);
+    }
+
+    if (pos != buf_len) {
+        fprintf(stderr, "%zu trailing bytes\n", buf_len - pos);
+    }
+
+    return 0;
+}